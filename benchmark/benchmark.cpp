@@ -0,0 +1,695 @@
+/**
+  * Benchmark of the pipeline stages on the sample plans and on
+  * synthetic, upscaled versions of them.
+  *
+  * Usage:
+  *   cityplan_benchmark [options] [image ...]
+  *       Runs the whole pipeline on every image (default: the
+  *       CV_sample_*.png plans) at every scale and reports the
+  *       wall time, throughput and peak memory of each stage.
+  *       "total" is the wall time of the whole processImage call.
+  *       Every stage of the untiled pipeline is then also run on
+  *       its own, on a copy of its pipeline input ("isolated/...").
+  *
+  *   Options:
+  *   --runs <n>
+  *       Measured runs per image and scale (default 5), after
+  *       one warm-up run.
+  *   --scales <a,b,...>
+  *       Upscale factors for the synthetic plans (default 1,2).
+  *   --kernel <scalar | sse2 | avx2>
+  *       Highest instruction set the threshold kernels may use.
+  *   --tile <size>
+  *       Runs the tiled pipeline.
+  *   --out <file>
+  *       Result file (default benchmark.json).
+  *   --baseline <file>
+  *       Compares the results with an earlier result file. Exits
+  *       with 1 if the total time of any plan got slower.
+  *   --tolerance <percent>
+  *       Slow down that still counts as unchanged (default 5).
+  *
+  *   cityplan_benchmark --unionfind <n> [--runs <k>]
+  *       Compares UnionFind (one thread) with ConcurrentUnionFind
+  *       on 1 to 32 threads: 2n merges of n objects, then a find
+  *       of every object.
+  *
+  * Author: phugen
+  */
+
+#include "include/opencvincludes.hpp"
+#include "include/pipeline.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
+#include "include/debugview.hpp"
+#include "include/thresholdkernel.hpp"
+#include "include/text_segmentation/unionfind.hpp"
+#include "include/text_segmentation/auxiliary.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/areafilter.hpp"
+#include "include/text_segmentation/collineargrouping.hpp"
+#include "include/vectorization/vectorize.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <functional>
+
+
+using namespace std;
+using namespace cv;
+
+
+// All measured runs of one stage of one plan.
+struct StageSamples
+{
+    string name;
+    vector<double> ms;
+    long long peakBytes;
+};
+
+// Results of one plan at one scale.
+struct BenchmarkCase
+{
+    string image;
+    double scale;
+    double megapixels;
+    vector<StageSamples> stages; // top-level stages in pipeline order, "total", then the isolated stages
+};
+
+// Mean and standard deviation of a stage in an earlier result file.
+struct BaselineEntry
+{
+    double meanMs;
+    double stddevMs;
+};
+
+
+static double mean (const vector<double>& values)
+{
+    double sum = 0.;
+
+    for(auto v = values.begin(); v != values.end(); v++)
+        sum += *v;
+
+    return values.empty() ? 0. : sum / values.size();
+}
+
+// sample standard deviation
+static double stddev (const vector<double>& values)
+{
+    if(values.size() < 2)
+        return 0.;
+
+    double m = mean(values);
+    double sum = 0.;
+
+    for(auto v = values.begin(); v != values.end(); v++)
+        sum += (*v - m) * (*v - m);
+
+    return sqrt(sum / (values.size() - 1));
+}
+
+static double elapsedMs (chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Largest memory peak of the top-level stages of a profiler (-1 = none).
+static long long topLevelPeak (const StageProfiler& profiler)
+{
+    long long peak = -1;
+    const vector<StageProfiler::StageRecord>& records = profiler.records();
+
+    for(auto rec = records.begin(); rec != records.end(); rec++)
+        if((*rec).name.find('/') == string::npos)
+            peak = max(peak, (*rec).peakBytes);
+
+    return peak;
+}
+
+static StageSamples* samplesFor (BenchmarkCase* bc, const string& stage)
+{
+    for(auto s = bc->stages.begin(); s != bc->stages.end(); s++)
+        if((*s).name == stage)
+            return &(*s);
+
+    StageSamples samples;
+    samples.name = stage;
+    samples.peakBytes = -1;
+    bc->stages.push_back(samples);
+
+    return &bc->stages.back();
+}
+
+// Runs the pipeline "runs" times on one image. Every run
+// reports to a fresh profiler that also tracks memory.
+static void measure (const Mat& image, const PipelineOptions& options, int runs, BenchmarkCase* bc)
+{
+    // warm-up: caches, page faults, thread pool start
+    processImage(image, "benchmark_out", options);
+
+    for(int r = 0; r < runs; r++)
+    {
+        StageProfiler profiler;
+        profiler.setTrackMemory(true);
+        setActiveProfiler(&profiler);
+
+        // wall time of the whole run, including the work between the stages
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        processImage(image, "benchmark_out", options);
+        double wallMs = elapsedMs(start);
+
+        setActiveProfiler(NULL);
+
+        // sub-stages are part of their top-level stage
+        const vector<StageProfiler::StageRecord>& records = profiler.records();
+
+        for(auto rec = records.begin(); rec != records.end(); rec++)
+        {
+            if((*rec).name.find('/') != string::npos)
+                continue;
+
+            StageSamples* samples = samplesFor(bc, (*rec).name);
+            samples->ms.push_back((*rec).ms);
+            samples->peakBytes = max(samples->peakBytes, (*rec).peakBytes);
+        }
+
+        StageSamples* total = samplesFor(bc, "total");
+        total->ms.push_back(wallMs);
+        total->peakBytes = max(total->peakBytes, topLevelPeak(profiler));
+    }
+
+    // "total" always comes last
+    for(size_t s = 0; s + 1 < bc->stages.size(); s++)
+        if(bc->stages[s].name == "total")
+            rotate(bc->stages.begin() + s, bc->stages.begin() + s + 1, bc->stages.end());
+}
+
+// Times "runs" calls of one stage as "isolated/<name>". prepare() makes
+// a fresh copy of the stage input before each call and isn't timed.
+static void timeStage (const string& name, int runs, const function<void ()>& prepare, const function<void ()>& stage,
+                       BenchmarkCase* bc)
+{
+    StageSamples* samples = samplesFor(bc, "isolated/" + name);
+
+    for(int r = 0; r < runs; r++)
+    {
+        prepare();
+
+        StageProfiler profiler;
+        profiler.setTrackMemory(true);
+        setActiveProfiler(&profiler);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        stage();
+        samples->ms.push_back(elapsedMs(start));
+
+        setActiveProfiler(NULL);
+
+        samples->peakBytes = max(samples->peakBytes, topLevelPeak(profiler));
+    }
+}
+
+// Runs each stage of the untiled pipeline on its own. The inputs are
+// made once by running the stages in order, as processImage does.
+static void measureIsolated (const Mat& image, const PipelineOptions& options, int runs, BenchmarkCase* bc)
+{
+    Mat black, labeled, labels, textFree;
+    vector<ConnectedComponent> components, filtered;
+
+    auto blackLayer = [&]()
+    {
+        if(options.autoThreshold)
+            getAutoBlackLayer(image, &black);
+        else
+            getBlackLayer(options.thresholds, image, &black);
+    };
+
+    blackLayer();
+
+    labeled = black.clone();
+    unionFindComponents(&labeled, &components, options.minPx, 0, &labels);
+
+    filtered = components;
+    areaFilter(&filtered, options.ratio);
+
+    collinearGrouping(labeled, &textFree, &filtered, &labels);
+
+    // the copies the stages work on
+    Mat stageImage;
+    vector<ConnectedComponent> stageComponents;
+
+    timeStage("blackLayer", runs, [&]() { black.release(); }, blackLayer, bc);
+
+    timeStage("unionFindComponents", runs,
+              [&]() { stageImage = black.clone(); stageComponents.clear(); },
+              [&]() { Mat stageLabels; unionFindComponents(&stageImage, &stageComponents, options.minPx, 0, &stageLabels); }, bc);
+
+    timeStage("areaFilter", runs,
+              [&]() { stageComponents = components; },
+              [&]() { areaFilter(&stageComponents, options.ratio); }, bc);
+
+    timeStage("collinearGrouping", runs,
+              [&]() { stageComponents = filtered; },
+              [&]() { Mat output; collinearGrouping(labeled, &output, &stageComponents, &labels); }, bc);
+
+    timeStage("vectorizeImage", runs,
+              [&]() { stageImage = textFree.clone(); },
+              [&]() { vectorizeImage(&stageImage, NULL, "benchmark_out", options.epsilon); }, bc);
+}
+
+// Every stage is written on a line of its own,
+// which is what readBaseline() relies on.
+static bool writeResults (const string& filename, const vector<BenchmarkCase>& cases, int runs, const string& kernel)
+{
+    ofstream file(filename.c_str());
+
+    if(!file)
+        return false;
+
+    file << fixed << setprecision(3);
+    file << "{\n";
+    file << "  \"runs\": " << runs << ",\n";
+    file << "  \"kernel\": " << jsonString(kernel) << ",\n";
+    file << "  \"cases\": [";
+
+    for(size_t c = 0; c < cases.size(); c++)
+    {
+        const BenchmarkCase& bc = cases[c];
+
+        file << (c == 0 ? "\n" : ",\n");
+        file << "    {\n";
+        file << "      \"image\": " << jsonString(bc.image) << ",\n";
+        file << "      \"scale\": " << bc.scale << ",\n";
+        file << "      \"megapixels\": " << bc.megapixels << ",\n";
+        file << "      \"stages\": {";
+
+        for(size_t s = 0; s < bc.stages.size(); s++)
+        {
+            const StageSamples& st = bc.stages[s];
+            double m = mean(st.ms);
+
+            file << (s == 0 ? "\n" : ",\n");
+            file << "        " << jsonString(st.name) << ": {"
+                 << " \"meanMs\": " << m
+                 << ", \"stddevMs\": " << stddev(st.ms)
+                 << ", \"minMs\": " << *min_element(st.ms.begin(), st.ms.end())
+                 << ", \"maxMs\": " << *max_element(st.ms.begin(), st.ms.end())
+                 << ", \"mpPerSec\": " << (m > 0. ? bc.megapixels / (m / 1000.) : 0.)
+                 << ", \"peakRSS\": " << st.peakBytes << " }";
+        }
+
+        file << "\n      }\n    }";
+    }
+
+    file << "\n  ]\n}\n";
+
+    return file.good();
+}
+
+// Value of a number field ("key": value) in a line, or NAN.
+static double numberField (const string& line, const string& key)
+{
+    size_t pos = line.find("\"" + key + "\":");
+
+    if(pos == string::npos)
+        return NAN;
+
+    return atof(line.c_str() + pos + key.size() + 3);
+}
+
+// First string in quotes after position "from", without the quotes.
+static string quotedString (const string& line, size_t from)
+{
+    size_t start = line.find('"', from);
+    size_t end = start == string::npos ? string::npos : line.find('"', start + 1);
+
+    if(end == string::npos)
+        return "";
+
+    return line.substr(start + 1, end - start - 1);
+}
+
+static string caseKey (const string& image, double scale, const string& stage)
+{
+    ostringstream key;
+    key << image << " x" << scale << " " << stage;
+
+    return key.str();
+}
+
+// Reads the stage means of a result file written by writeResults().
+static bool readBaseline (const string& filename, map<string, BaselineEntry>* baseline)
+{
+    ifstream file(filename.c_str());
+
+    if(!file)
+        return false;
+
+    string line, image;
+    double scale = 1.;
+
+    while(getline(file, line))
+    {
+        if(line.find("\"image\":") != string::npos)
+            image = quotedString(line, line.find(':'));
+
+        else if(line.find("\"scale\":") != string::npos)
+            scale = numberField(line, "scale");
+
+        else if(line.find("\"meanMs\":") != string::npos)
+        {
+            BaselineEntry entry;
+            entry.meanMs = numberField(line, "meanMs");
+            entry.stddevMs = numberField(line, "stddevMs");
+
+            (*baseline)[caseKey(image, scale, quotedString(line, 0))] = entry;
+        }
+    }
+
+    return true;
+}
+
+// Prints the change of every stage against the baseline. A stage is
+// slower if it lost more than "tolerance" percent and the difference
+// is larger than twice the measuring noise of both runs.
+// Returns the number of plans whose total time got slower.
+static int compareWithBaseline (const vector<BenchmarkCase>& cases, const map<string, BaselineEntry>& baseline, double tolerance)
+{
+    int slowerPlans = 0;
+
+    printf("\n%-42s %12s %12s %9s\n", "stage", "baseline ms", "current ms", "change");
+
+    for(auto bc = cases.begin(); bc != cases.end(); bc++)
+        for(auto st = (*bc).stages.begin(); st != (*bc).stages.end(); st++)
+        {
+            string key = caseKey((*bc).image, (*bc).scale, (*st).name);
+            auto base = baseline.find(key);
+
+            if(base == baseline.end())
+            {
+                printf("%-42s %12s %12.3f %9s\n", key.c_str(), "-", mean((*st).ms), "new");
+                continue;
+            }
+
+            double before = (*base).second.meanMs;
+            double after = mean((*st).ms);
+            double change = before > 0. ? (after - before) / before * 100. : 0.;
+            double noise = 2. * sqrt((*base).second.stddevMs * (*base).second.stddevMs + stddev((*st).ms) * stddev((*st).ms));
+
+            const char* verdict = "";
+
+            if(change > tolerance && after - before > noise)
+            {
+                verdict = "  SLOWER";
+
+                if((*st).name == "total")
+                    slowerPlans++;
+            }
+
+            else if(change < -tolerance && before - after > noise)
+                verdict = "  faster";
+
+            printf("%-42s %12.3f %12.3f %+8.1f%%%s\n", key.c_str(), before, after, change, verdict);
+        }
+
+    return slowerPlans;
+}
+
+// Merge pairs that look like the equivalences of a labeling: mostly
+// between nearby labels, some between arbitrary ones.
+static vector<pair<int, int> > mergePairs (int n)
+{
+    mt19937 random(42);
+    vector<pair<int, int> > pairs(2 * (size_t) n);
+
+    for(auto p = pairs.begin(); p != pairs.end(); p++)
+    {
+        int a = random() % n;
+        int b = random() % 4 != 0 ? min(n - 1, a + 1 + (int) (random() % 8)) : random() % n;
+
+        *p = make_pair(a, b);
+    }
+
+    return pairs;
+}
+
+// keeps the compiler from dropping the finds
+static volatile long long findSink;
+
+// Best of "runs" times of the sequential union find.
+static double sequentialUnionFind (int n, const vector<pair<int, int> >& pairs, int runs, int* sets)
+{
+    double best = 1e300;
+
+    for(int r = 0; r < runs; r++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        UnionFind uf(n);
+
+        for(auto p = pairs.begin(); p != pairs.end(); p++)
+            uf.merge((*p).first, (*p).second);
+
+        long long sum = 0;
+        for(int i = 0; i < n; i++)
+            sum += uf.find(i);
+
+        best = min(best, elapsedMs(start));
+        *sets = uf.count();
+        findSink = sum;
+    }
+
+    return best;
+}
+
+// Best of "runs" times of the concurrent union find; every thread
+// merges its share of the pairs, then finds its share of the objects.
+static double concurrentUnionFind (int n, const vector<pair<int, int> >& pairs, int threads, int runs, int* sets)
+{
+    ConcurrentUnionFind uf;
+    double best = 1e300;
+
+    for(int r = 0; r < runs; r++)
+    {
+        uf.reset(n);
+        vector<long long> sums(threads, 0);
+        vector<thread> workers;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        for(int t = 0; t < threads; t++)
+            workers.push_back(thread([&, t]()
+            {
+                size_t from = pairs.size() * t / threads, to = pairs.size() * (t + 1) / threads;
+
+                for(size_t p = from; p < to; p++)
+                    uf.merge(pairs[p].first, pairs[p].second);
+
+                for(int i = (int) ((long long) n * t / threads); i < (long long) n * (t + 1) / threads; i++)
+                    sums[t] += uf.find(i);
+            }));
+
+        for(auto w = workers.begin(); w != workers.end(); w++)
+            (*w).join();
+
+        best = min(best, elapsedMs(start));
+        *sets = uf.count();
+
+        for(int t = 0; t < threads; t++)
+            findSink += sums[t];
+    }
+
+    return best;
+}
+
+// Prints the times of both union finds; exits with 1 if the
+// concurrent version ends up with different sets.
+static int benchmarkUnionFind (int n, int runs)
+{
+    vector<pair<int, int> > pairs = mergePairs(n);
+    int expectedSets, sets;
+
+    double sequential = sequentialUnionFind(n, pairs, runs, &expectedSets);
+    printf("UnionFind            %2d thread(s) %10.1f ms  (%d objects, %zu merges, %d sets)\n",
+           1, sequential, n, pairs.size(), expectedSets);
+
+    for(int threads = 1; threads <= 32; threads *= 2)
+    {
+        double concurrent = concurrentUnionFind(n, pairs, threads, runs, &sets);
+        printf("ConcurrentUnionFind  %2d thread(s) %10.1f ms  %6.2fx%s\n",
+               threads, concurrent, sequential / concurrent, sets != expectedSets ? "  WRONG SET COUNT" : "");
+
+        if(sets != expectedSets)
+            return 1;
+    }
+
+    return 0;
+}
+
+static vector<double> parseScales (const string& list)
+{
+    vector<double> scales;
+    stringstream stream(list);
+    string item;
+
+    while(getline(stream, item, ','))
+    {
+        double s = atof(item.c_str());
+
+        if(s > 0.)
+            scales.push_back(s);
+    }
+
+    return scales;
+}
+
+
+int main (int argc, char** argv)
+{
+    PipelineOptions options;
+    options.timingReport = false;
+
+    int runs = 5;
+    vector<double> scales = { 1., 2. };
+    string outFile = "benchmark.json";
+    string baselineFile;
+    string kernel = "avx2";
+    double tolerance = 5.;
+    int unionFindObjects = 0;
+    vector<string> images;
+
+    for(int a = 1; a < argc; a++)
+    {
+        string arg = argv[a];
+        bool hasValue = a + 1 < argc;
+
+        if(arg == "--runs" && hasValue)
+            runs = max(1, atoi(argv[++a]));
+        else if(arg == "--scales" && hasValue)
+            scales = parseScales(argv[++a]);
+        else if(arg == "--kernel" && hasValue)
+            kernel = argv[++a];
+        else if(arg == "--tile" && hasValue)
+            options.tileSize = max(0, atoi(argv[++a]));
+        else if(arg == "--out" && hasValue)
+            outFile = argv[++a];
+        else if(arg == "--baseline" && hasValue)
+            baselineFile = argv[++a];
+        else if(arg == "--tolerance" && hasValue)
+            tolerance = atof(argv[++a]);
+        else if(arg == "--unionfind" && hasValue)
+            unionFindObjects = atoi(argv[++a]);
+        else if(arg.compare(0, 2, "--") == 0)
+        {
+            cout << "Unknown option " << arg << "\n";
+            return 2;
+        }
+        else
+            images.push_back(arg);
+    }
+
+    if(unionFindObjects > 0)
+        return benchmarkUnionFind(unionFindObjects, runs);
+
+    if(kernel == "scalar")
+        setThresholdKernelLevel(KERNEL_SCALAR);
+    else if(kernel == "sse2")
+        setThresholdKernelLevel(KERNEL_SSE2);
+    else if(kernel == "avx2")
+        setThresholdKernelLevel(KERNEL_AVX2);
+    else
+    {
+        cout << "Unknown kernel " << kernel << "\n";
+        return 2;
+    }
+
+    if(scales.empty())
+    {
+        cout << "--scales needs positive factors.\n";
+        return 2;
+    }
+
+    if(images.empty())
+        images = { "CV_sample_leicht.png", "CV_sample_mittel.png", "CV_sample_mittel2.png",
+                   "CV_sample_schwer.png", "CV_sample_schwer_2.png" };
+
+    // no windows, no debug images, no stage messages
+    setDebugView(false);
+    ostream quiet(NULL); // no buffer: all messages are dropped
+    setPipelineLog(&quiet);
+
+    vector<BenchmarkCase> cases;
+
+    for(auto file = images.begin(); file != images.end(); file++)
+    {
+        Mat original = imread(*file);
+
+        if(!original.data)
+        {
+            cout << "Couldn't load " << *file << ", skipped.\n";
+            continue;
+        }
+
+        for(auto scale = scales.begin(); scale != scales.end(); scale++)
+        {
+            // synthetic plan: the same plan at a higher resolution
+            Mat image;
+            if(*scale == 1.)
+                image = original;
+            else
+                resize(original, image, Size(), *scale, *scale, INTER_NEAREST);
+
+            BenchmarkCase bc;
+            bc.image = *file;
+            bc.scale = *scale;
+            bc.megapixels = image.rows * (double) image.cols / 1e6;
+
+            measure(image, options, runs, &bc);
+            measureIsolated(image, options, runs, &bc);
+            cases.push_back(bc);
+
+            const StageSamples& total = *samplesFor(&bc, "total");
+            printf("%-28s x%-4g %8.2f MP %10.1f ms +- %7.1f %8.2f MP/s %8.1f MB peak\n",
+                   (*file).c_str(), *scale, bc.megapixels, mean(total.ms), stddev(total.ms),
+                   bc.megapixels / (mean(total.ms) / 1000.), total.peakBytes / (1024. * 1024.));
+        }
+    }
+
+    setPipelineLog(NULL);
+
+    if(cases.empty())
+        return 2;
+
+    if(!writeResults(outFile, cases, runs, kernel))
+        cout << "Couldn't write " << outFile << "\n";
+
+    if(baselineFile.empty())
+        return 0;
+
+    map<string, BaselineEntry> baseline;
+
+    if(!readBaseline(baselineFile, &baseline))
+    {
+        cout << "Couldn't read baseline " << baselineFile << "\n";
+        return 2;
+    }
+
+    int slower = compareWithBaseline(cases, baseline, tolerance);
+
+    if(slower > 0)
+        printf("\n%d plan(s) got slower than the baseline.\n", slower);
+
+    return slower > 0 ? 1 : 0;
+}
@@ -0,0 +1,8 @@
+# Benchmark of the pipeline stages on the sample plans;
+# same sources and libraries as the main program.
+include(cityplan_vectorization.pro)
+
+TARGET = cityplan_benchmark
+
+SOURCES -= src/main.cpp
+SOURCES += benchmark/benchmark.cpp
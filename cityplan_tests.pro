@@ -0,0 +1,16 @@
+# Tests of the pipeline stages; same sources and
+# libraries as the main program.
+include(cityplan_vectorization.pro)
+
+TARGET = cityplan_tests
+
+SOURCES -= src/main.cpp
+HEADERS += test/tests.hpp
+
+SOURCES += test/main.cpp \
+    test/areafiltertest.cpp \
+    test/labelingtest.cpp \
+    test/relabeltest.cpp \
+    test/runstest.cpp \
+    test/tiledtexttest.cpp \
+    test/unionfindtest.cpp
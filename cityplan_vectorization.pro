@@ -8,18 +8,32 @@ TARGET = cityplan_vectorization
 CONFIG += console
 CONFIG -= app_bundle
 CONFIG += c++11
+CONFIG += thread
+
+# production builds: no debug windows or debug images at all
+#DEFINES += NO_DEBUG_VIEW
 
 TEMPLATE = app
 
 SOURCES += \
     src/main.cpp \
+    src/debugview.cpp \
+    src/pipeline.cpp \
+    src/stageprofiler.cpp \
+    src/tiling.cpp \
+    src/pipelinelog.cpp \
+    src/thresholdkernel.cpp \
+    src/binaryimage.cpp \
+    src/stripreader.cpp \
     src/text_segmentation/areafilter.cpp \
     src/text_segmentation/auxiliary.cpp \
+    src/text_segmentation/blocklabeling.cpp \
     src/text_segmentation/collineargroup.cpp \
     src/text_segmentation/collineargrouping.cpp \
     src/text_segmentation/collinearphrase.cpp \
     src/text_segmentation/collinearstring.cpp \
     src/text_segmentation/colorconversions.cpp \
+    src/text_segmentation/componentstore.cpp \
     src/text_segmentation/connectedcomponent.cpp \
     src/text_segmentation/customhoughtransform.cpp \
     src/text_segmentation/statistics.cpp \
@@ -34,6 +48,14 @@ SOURCES += \
 
 HEADERS += \
     include/opencvincludes.hpp \
+    include/debugview.hpp \
+    include/pipeline.hpp \
+    include/stageprofiler.hpp \
+    include/tiling.hpp \
+    include/pipelinelog.hpp \
+    include/thresholdkernel.hpp \
+    include/binaryimage.hpp \
+    include/stripreader.hpp \
     include/vec2icompare.hpp \
     include/cairo/drm/cairo-drm-i915-private.h \
     include/cairo/drm/cairo-drm-i965-private.h \
@@ -188,11 +210,13 @@ HEADERS += \
     include/cairo/test-paginated-surface.h \
     include/text_segmentation/areafilter.hpp \
     include/text_segmentation/auxiliary.hpp \
+    include/text_segmentation/blocklabeling.hpp \
     include/text_segmentation/collineargroup.hpp \
     include/text_segmentation/collineargrouping.hpp \
     include/text_segmentation/collinearphrase.hpp \
     include/text_segmentation/collinearstring.hpp \
     include/text_segmentation/colorconversions.hpp \
+    include/text_segmentation/componentstore.hpp \
     include/text_segmentation/connectedcomponent.hpp \
     include/text_segmentation/customhoughtransform.hpp \
     include/text_segmentation/statistics.hpp \
@@ -217,5 +241,8 @@ LIBS += -LC:/opencv/build/x86/mingw/bin \
 # Cairo library; for generating .svg files
 LIBS += -L"$$PWD/lib" -lcairo
 
+# peak memory of the stage profiler
+win32: LIBS += -lpsapi
+
 
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Binary image with one bit per pixel. Set bits are foreground
+// pixels (e.g. the black pixels of the black layer).
+//
+// Pixel (i, j) is bit (j % 64) of word (j / 64) in row i. Bits right
+// of the last column are always 0, and there is one empty row above
+// and below the image, so neighborhoods can be read without checking
+// the top and bottom borders.
+class BinaryImage
+{
+    int height, width, wordsPerRow;
+    std::vector<uint64_t> bits;
+
+    public:
+        BinaryImage();
+        BinaryImage(int rows, int cols);
+
+        // Packs all pixels of a CV_8U image that are equal to "foreground".
+        // Works on ROIs of larger images.
+        explicit BinaryImage(const cv::Mat& image, uchar foreground = 0);
+
+        // Writes the image to a CV_8U matrix (allocated if necessary).
+        void toMat(cv::Mat* output, uchar foreground = 0, uchar background = 255) const;
+
+        int rows() const { return height; }
+        int cols() const { return width; }
+        int words() const { return wordsPerRow; }
+
+        // Words of row i; rows -1 and rows() are valid (and empty).
+        uint64_t* row(int i) { return &bits[(i + 1) * wordsPerRow]; }
+        const uint64_t* row(int i) const { return &bits[(i + 1) * wordsPerRow]; }
+
+        bool get(int i, int j) const { return (row(i)[j >> 6] >> (j & 63)) & 1; }
+        void set(int i, int j) { row(i)[j >> 6] |= (uint64_t) 1 << (j & 63); }
+        void clear(int i, int j) { row(i)[j >> 6] &= ~((uint64_t) 1 << (j & 63)); }
+
+        // Like get(), but pixels outside of the image are 0.
+        bool at(int i, int j) const { return j >= 0 && j < width && get(i, j); }
+
+        // The 64 pixels (j .. j+63) of row i as one word, pixel j in bit 0.
+        // Pixels outside of the image are 0.
+        uint64_t span(int i, int j) const;
+
+        // Encoding of the 8-neighborhood of (i, j); a bit is 1
+        // if that neighbor is set, out-of-image pixels are 0:
+        //
+        //    64  128  1
+        //    32   c   2
+        //    16   8   4
+        uint8_t neighbors(int i, int j) const;
+
+        // First and last column of each run of set pixels in row i.
+        void runs(int i, std::vector<cv::Vec2i>* runs) const;
+
+        long long count() const;
+};
+
+// Index of the lowest set bit of a non-zero word.
+inline int lowestBit(uint64_t word)
+{
+    return __builtin_ctzll(word);
+}
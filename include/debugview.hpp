@@ -0,0 +1,32 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+
+#include <string>
+
+// Building with NO_DEBUG_VIEW defined removes all debug
+// visualization: the functions below become empty inlines
+// and code guarded by debugViewEnabled() is dropped.
+#ifdef NO_DEBUG_VIEW
+
+inline void setDebugView(bool) {}
+inline bool debugViewEnabled() { return false; }
+
+inline void debugShow(const std::string&, const cv::Mat&, int = cv::WINDOW_NORMAL) {}
+inline void debugWrite(const std::string&, const cv::Mat&) {}
+inline void debugWait() {}
+inline void flushDebugWrites() {}
+
+#else
+
+// Switches all debug windows and debug image files on or off.
+// Enabled by default; batch runs switch it off.
+void setDebugView(bool enabled);
+bool debugViewEnabled();
+
+void debugShow(const std::string& window, const cv::Mat& image, int flags = cv::WINDOW_NORMAL);
+void debugWrite(const std::string& filename, const cv::Mat& image);
+void debugWait();
+void flushDebugWrites();
+
+#endif
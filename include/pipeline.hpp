@@ -0,0 +1,32 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+
+#include <string>
+#include <vector>
+
+// Parameters for one run of the whole
+// text removal + vectorization pipeline.
+struct PipelineOptions
+{
+    PipelineOptions();
+
+    cv::Vec3b thresholds; // black layer thresholds (BGR)
+    bool autoThreshold; // choose the thresholds per plan from its histogram instead
+    int minPx; // components with fewer black pixels are removed
+    int ratio; // MBR side ratio for the area filter
+    double epsilon; // Douglas-Peucker error
+    bool timingReport; // write per-stage times and counters to "<output>.timing.json"
+    int tileSize; // process the plan in tiles of this size (0 = whole plan at once)
+    int tileOverlap; // extra border around each tile for thinning
+    int workers; // number of plans processed at the same time in batch mode
+    int maxResident; // max. number of plans loaded at the same time (0 = workers)
+    bool recoverColors; // keep the color image for color polygons (untiled runs; no streaming decode)
+};
+
+void processImage (const cv::Mat& original, const std::string& outputFile, const PipelineOptions& options);
+int processPlan (const std::string& inputFile, const std::string& outputFile, const PipelineOptions& options, double* elapsedMs = NULL);
+
+std::vector<std::string> collectInputFiles (const std::string& source);
+std::string outputNameFor (const std::string& inputFile, const std::string& outputDir);
+int runBatch (const std::vector<std::string>& inputFiles, const std::string& outputDir, const PipelineOptions& options);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ostream>
+
+// Stream for the progress messages of the pipeline stages.
+// Each thread has its own; it is std::cout unless set otherwise,
+// e.g. by a batch worker that keeps one log per plan.
+std::ostream& pipelineLog();
+void setPipelineLog(std::ostream* stream);
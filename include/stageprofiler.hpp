@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @brief Collects wall clock times and work counters
+ * (pixels scanned, components, lines, ...) for each stage
+ * of the pipeline, so a report can be written per image.
+ */
+class StageProfiler
+{
+public:
+    struct StageRecord
+    {
+        std::string name;
+        double ms;
+        int calls;
+        long long peakBytes; // peak resident memory, -1 = not tracked
+        std::vector<std::pair<std::string, long long>> counters;
+    };
+
+    StageProfiler();
+
+    void addTime(const std::string& stage, double ms);
+    void addCounter(const std::string& stage, const std::string& counter, long long value);
+    void addPeakMemory(const std::string& stage, long long bytes);
+    void clear();
+
+    // Stage timers also record the peak resident memory (off by default)
+    void setTrackMemory(bool enabled);
+    bool tracksMemory() const;
+
+    double totalTime() const; // sum of all top-level stage times in ms
+    const std::vector<StageRecord>& records() const;
+
+    // totalMs: wall time of the whole run
+    std::string toJSON(const std::string& image, double totalMs) const;
+    bool writeJSON(const std::string& filename, const std::string& image, double totalMs) const;
+
+private:
+    StageRecord* record(const std::string& stage);
+
+    std::vector<StageRecord> stages; // in order of first appearance
+    bool trackMemory;
+};
+
+// The profiler that stage timers and counters of the
+// calling thread report to. NULL switches profiling off.
+void setActiveProfiler(StageProfiler* profiler);
+StageProfiler* activeProfiler();
+
+// Quotes a string for a JSON file (escapes quotes,
+// backslashes and control characters).
+std::string jsonString (const std::string& s);
+
+// Adds a work counter to a stage of the active profiler.
+void countStage(const std::string& stage, const std::string& counter, long long value);
+
+// Peak resident memory (bytes) of the process since the start
+// or since the last successful resetPeakResident(); -1 if unknown.
+// Resetting is only supported on Linux.
+long long peakResidentBytes();
+bool resetPeakResident();
+
+/**
+ * @brief Measures the time between its construction and
+ * destruction and adds it to a stage of the active profiler.
+ */
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(const std::string& stage);
+    ~ScopedStageTimer();
+
+private:
+    std::string stage;
+    std::chrono::steady_clock::time_point start;
+};
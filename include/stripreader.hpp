@@ -0,0 +1,45 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Decodes an image file a few rows at a time, so
+ * the full color image never has to be in memory.
+ *
+ * Supports binary PGM/PPM (maxval 255) and uncompressed 24/32 bit BMP;
+ * open() fails for all other files, which then have to be
+ * loaded with imread.
+ */
+class StripReader
+{
+public:
+    StripReader();
+
+    bool open(const std::string& filename);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+
+    // Reads up to maxRows rows into "strip" (CV_8UC3, BGR). The strip
+    // then holds the image rows firstRow .. firstRow + n - 1, top to
+    // bottom. Returns n; 0 at the end of the image or on read errors.
+    int read(int maxRows, cv::Mat* strip, int* firstRow);
+
+private:
+    enum Format { NONE, PNM_GRAY, PNM_COLOR, BMP_24, BMP_32 };
+
+    bool openPNM();
+    bool openBMP();
+
+    std::ifstream file;
+    Format format;
+    int width, height;
+    bool bottomUp; // BMP rows are stored bottom row first
+    int rowsRead;
+    size_t rowBytes; // bytes per row in the file, including padding
+    std::vector<unsigned char> buffer;
+};
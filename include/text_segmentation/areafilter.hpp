@@ -1,11 +1,53 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 
 #include "include/opencvincludes.hpp"
 #include "connectedcomponent.hpp"
+#include "componentstore.hpp"
 
+// Decides whether a component is kept (true) by a filter.
+typedef std::function<bool (const ConnectedComponent&)> ComponentPredicate;
+
+// A filter composed of predicates: it keeps a component
+// if all of them do (checked in the order they were added).
+class ComponentFilter
+{
+public:
+    ComponentFilter& add(ComponentPredicate predicate);
+    bool operator () (const ConnectedComponent& comp) const;
+
+private:
+    std::vector<ComponentPredicate> predicates;
+};
+
+// Narrows down an index view of components (their ids in a store,
+// e.g. a cluster) as a whole; it may reorder the ids and drop some.
+typedef std::function<void (const ComponentStore&, std::vector<int>*)> ClusterStep;
+
+// A filter for index views composed of steps, applied in the order
+// they were added. Component filters are steps that keep the order
+// of the ids; steps like areaInliers look at the whole view.
+class ClusterFilter
+{
+public:
+    ClusterFilter& add(ClusterStep step);
+    ClusterFilter& add(const ComponentFilter& filter);
+    void operator () (const ComponentStore& store, std::vector<int>* ids) const;
+
+private:
+    std::vector<ClusterStep> steps;
+};
+
+ComponentPredicate aspectRatioAtMost(int ratio);
+ComponentPredicate densityAtLeast(double minDensity);
+ComponentPredicate areaBetween(int minArea, int maxArea);
+ClusterStep areaInliers(double maxError);
+
+void filterComponents(std::vector<ConnectedComponent>* components, const ComponentFilter& filter);
+std::vector<int> selectComponents(const std::vector<ConnectedComponent>& components, const ComponentFilter& filter);
 
 void areaFilter(std::vector<ConnectedComponent>* components, int ratio);
-void clusterCompAreaFilter(std::vector<ConnectedComponent>* cluster, double maxError);
+void areaInlierRange(const std::vector<int>& areas, double maxError, int* first, int* last);
 
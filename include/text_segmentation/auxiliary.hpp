@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "include/opencvincludes.hpp"
@@ -8,13 +9,17 @@
 cv::Vec2i pointToVec (cv::Point p);
 std::vector<cv::Vec2i> pointToVec (std::vector<cv::Point> pl);
 
-void getBlackLayer(cv::Vec3b thresholds, cv::Mat input, cv::Mat* output);
+void getBlackLayer(cv::Vec3b thresholds, const cv::Mat& input, cv::Mat* output);
+cv::Vec3b getAutoBlackLayer(const cv::Mat& input, cv::Mat* output);
+bool streamBlackLayer(const std::string& filename, cv::Vec3b thresholds, cv::Mat* output, int stripRows = 256, bool automatic = false, cv::Vec3b* chosen = NULL);
 
 std::vector<cv::Vec2i> eightConnectedBlackNeighbors(cv::Vec2i pixel, cv::Mat* image);
 std::vector<cv::Vec2i> getBlackComponentPixels (cv::Vec2i pixel, cv::Mat* image);
 //std::vector<cv::Vec2i> getNearestCorners(std::vector<cv::Vec2i> corners, cv::Vec2i pixel, cv::Mat* image, cv::Mat* reconstructed);
 void clusterCells (int totalNumberCells, float rhoStep, int numRho, cv::Vec3f primaryCellPos, std::vector<cv::Vec3f>* lines);
 void eraseComponentPixels (ConnectedComponent comp, cv::Mat* image);
+void eraseComponentRuns (const ConnectedComponent& comp, const std::vector<PixelRun>& runs, cv::Mat* image);
+void eraseComponentLabel (const ConnectedComponent& comp, const cv::Mat& labels, cv::Mat* image);
 void eraseConnectedPixels(cv::Vec2i seed, cv::Mat* image);
 
 double getMBRArea(ConnectedComponent comp);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "include/binaryimage.hpp"
+#include "include/text_segmentation/unionfind.hpp"
+
+// Minimum number of pixel rows per strip of the parallel labeling
+#ifndef LABELING_STRIP_ROWS
+#define LABELING_STRIP_ROWS 256
+#endif
+
+// Provisional labels of the 2x2 pixel blocks of a binary image
+// (0 = block without foreground pixels). There is one empty block
+// row above the image and one empty block column left and right of
+// it, so the neighbors of a block can be read without border checks.
+//
+// The image is labeled in horizontal strips of block rows. The labels
+// of strip s are firstLabel[s] + 1 .. firstLabel[s + 1], so per-label
+// tables can be filled strip by strip without sharing entries.
+struct BlockLabels
+{
+    int blockRows, blockCols; // blocks of the image (without padding)
+    int stride; // blockCols + 2
+    int count; // number of provisional labels issued (labels 1 .. count)
+    std::vector<int> labels;
+
+    std::vector<int> stripStart; // first block row of each strip (+ blockRows at the end)
+    std::vector<int> firstLabel; // labels issued before each strip (+ count at the end)
+
+    int strips() const { return stripStart.size() - 1; }
+
+    // label of the block that contains pixel (i, j)
+    int at(int i, int j) const { return labels[((i >> 1) + 1) * stride + (j >> 1) + 1]; }
+};
+
+void labelBlocks (const BinaryImage& image, BlockLabels* blocks, ConcurrentUnionFind* uf);
+
+// Labels in this many strips (at most one per block row) instead
+// of one per thread, e.g. to test the strip borders; 0 = automatic.
+void setLabelingStrips(int strips);
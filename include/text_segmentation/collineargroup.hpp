@@ -12,7 +12,7 @@ public:
     int size(); // returns number of components in this group
 
     char type;  // denotes whether this group is isolated ('i'), a word ('w') or even part of a phrase ('p')
-    std::vector<ConnectedComponent> chars; // contains pointers to all components that are part of this group
+    std::vector<int> chars; // ids (see ComponentStore) of all components that are part of this group
 };
 
 #endif // COLLINEARGROUP_HPP
@@ -6,4 +6,6 @@
 #include "connectedcomponent.hpp"
 
 struct compareByLineDistance;
-void collinearGrouping (cv::Mat input, cv::Mat *output, std::vector<ConnectedComponent>* comps);
+void findTextComponents (const cv::Mat& input, const std::vector<ConnectedComponent>& comps, std::vector<int>* text);
+void collinearGrouping (cv::Mat input, cv::Mat *output, std::vector<ConnectedComponent>* comps,
+                        const cv::Mat* labels = NULL);
@@ -11,5 +11,5 @@ public:
     // returns number of words in this phrase
     int size();
 
-    std::vector<CollinearGroup> words; // contains pointers to all words that are part of this phrase
+    std::vector<CollinearGroup> words; // contains all words that are part of this phrase
 };
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <vector>
-#include "include/text_segmentation/connectedcomponent.hpp"
+#include "include/text_segmentation/componentstore.hpp"
 #include "include/text_segmentation/collineargroup.hpp"
 #include "include/text_segmentation/collinearphrase.hpp"
 
@@ -9,10 +9,11 @@ class CollinearString
 {
 public:
 
-    CollinearString(std::vector<ConnectedComponent> cluster, double avgHeight);
+    CollinearString(const ComponentStore* store, std::vector<int> cluster, double avgHeight);
     ~CollinearString();
 
-    std::vector<ConnectedComponent> comps; // all components that are part of this string
+    const ComponentStore* store; // the components the ids refer to
+    std::vector<int> comps; // ids of all components that are part of this string
     std::vector<CollinearGroup> groups; // word groups in this string
     std::vector<CollinearPhrase> phrases; // phrases in this string
 
@@ -20,10 +21,10 @@ public:
     int phraseNo; // actual number of assigned phrases
 
     // finds average height in a 5-neighborhood
-    double localAvgHeight (std::vector<ConnectedComponent> cluster, int listPos);
+    double localAvgHeight (const std::vector<int>& cluster, int listPos);
 
     // finds smallest distance between current and next component MBR
-    double edgeToEdgeDistance (std::vector<ConnectedComponent> cluster, int listPos);
+    double edgeToEdgeDistance (const std::vector<int>& cluster, int listPos);
 
     // Classifies components in this string.
     void refine();
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/connectedcomponent.hpp"
+
+/**
+ * @brief The connected components grouped by collinearGrouping,
+ * stored column by column. A component is referred to by its id,
+ * its index in the columns (and in the component list the store was
+ * built from), so clusters, strings, words and phrases only hold ids.
+ */
+class ComponentStore
+{
+public:
+    ComponentStore();
+    ComponentStore(const std::vector<ConnectedComponent>& comps);
+    ~ComponentStore();
+
+    int size() const;
+    int add(const ConnectedComponent& comp); // returns the id of the new component
+
+    cv::Vec2i mbrMin(int id) const { return cv::Vec2i(minRow[id], minCol[id]); }
+    cv::Vec2i mbrMax(int id) const { return cv::Vec2i(maxRow[id], maxCol[id]); }
+    cv::Vec2i centroid(int id) const { return cv::Vec2i(centroidRow[id], centroidCol[id]); }
+
+    // same MBR (the equality of ConnectedComponent)
+    bool sameMBR(int a, int b) const;
+
+    // the component rebuilt from the columns (without seed and label)
+    ConnectedComponent component(int id) const;
+
+    std::vector<int> minRow, minCol, maxRow, maxCol; // MBR corners
+    std::vector<int> centroidRow, centroidCol; // midpoint of the MBR
+    std::vector<int> area; // area of the MBR
+    std::vector<int> numBlackPixels; // number of black pixels
+    std::vector<cv::Vec3f> houghLine; // Hough line associated with the component (if any)
+};
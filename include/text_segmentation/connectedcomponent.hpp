@@ -2,6 +2,13 @@
 
 #include "include/opencvincludes.hpp"
 
+// A horizontal run of black pixels of a component:
+// columns colStart .. colEnd (inclusive) of one row.
+struct PixelRun
+{
+    int row, colStart, colEnd;
+};
+
 /**
  * @brief A class containing information about
  * a connected component found in an image, as detailed
@@ -31,4 +38,6 @@ public:
     cv::Vec3f houghLine; // Hough line associated with this component (if any).
     int area; // total area occupied by this component's MBR
     int numBlackPixels; // number of black pixels in this component
+    int label; // label of this component's pixels in the labeling it was found in
+    int firstRun, numRuns; // runs of this component in the run list of its labeling (numRuns = 0: none)
 };
@@ -1,10 +1,8 @@
 #pragma once
 
 #include "include/opencvincludes.hpp"
-#include "include/vec2icompare.hpp"
 
 #include <vector>
-#include <map>
 
 
 
@@ -21,12 +19,46 @@ struct LinePolar
 };
 
 
-void HoughLinesCustom( const cv::Mat& img, float rho, float theta,
+// Remembers which points voted into a Hough accumulator in which passes
+// (calls of HoughLinesPoints), so the votes of a point can be removed
+// exactly once. The votes themselves aren't stored: they are computed
+// again from the sin/cos tables of the passes, so the memory needed is
+// O(points) plus O(angles) per pass.
+class HoughContributions
+{
+public:
+    HoughContributions() : sorted(true) {}
+
+    int size() const { return points.size(); }
+
+    int find(cv::Vec2i point) const; // id of a voting point (-1 = none)
+    int add(cv::Vec2i point); // id of the point, added if it is new
+
+    void beginPass(float rho, float theta, double min_theta, int numangle, int numrho);
+    void vote(int id, int* accum); // the point votes in the current pass
+    void remove(int id, int* accum); // removes all votes of the point (once)
+
+private:
+    // parameters of a voting pass
+    struct Pass
+    {
+        int numangle, numrho;
+        std::vector<float> tabSin, tabCos;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<cv::Vec2i> points; // (row, col) of each point, by id
+    std::vector<unsigned> votedIn; // bit p: the point has votes from pass p
+    mutable std::vector<int> byPosition; // ids in raster order of their points, for find
+    mutable bool sorted; // byPosition is in order
+};
+
+void HoughLinesPoints (const std::vector<cv::Vec2i>& points, cv::Size imageSize, float rho, float theta,
                        double min_theta, double max_theta, int* accum,
-                       std::map<cv::Vec2i, std::vector<int>, Vec2iCompare>* contributions);
+                       HoughContributions* contributions);
 
 void HoughLinesExtract (int* accum, int numrho, int numangle, float rho, float theta, float min_theta,
                         int threshold, std::vector<cv::Vec3f> *lines, int mode = THRESH_GT);
 
-void deleteLineContributions (int* accum, cv::Vec2i inputPoint, std::map<cv::Vec2i, std::vector<int>, Vec2iCompare> contributions);
+void deleteLineContributions (int* accum, cv::Vec2i inputPoint, HoughContributions* contributions);
 
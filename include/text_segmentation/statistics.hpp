@@ -10,7 +10,29 @@ struct parametricLine
     double b;
 };
 
-template<typename T> double median (std::vector<T> elements);
-parametricLine leastSquaresLine(std::vector<ConnectedComponent>);
-parametricLine leastMedianSquaresLine(std::vector<ConnectedComponent>, float p, float t);
+// Default seed of the Least Median Squares trials
+#ifndef LMS_SEED
+#define LMS_SEED 1
+#endif
+
+// Minimum number of values for evaluating the trials in parallel
+#ifndef LMS_PARALLEL_MIN_SIZE
+#define LMS_PARALLEL_MIN_SIZE 4096
+#endif
+
+// Medians and quantiles by selection (std::nth_element) instead of sorting.
+// The pointer versions work in place and reorder the values; the vector
+// versions copy into a scratch buffer of the calling thread first.
+template<typename T> double selectQuantile (T* values, int n, double q);
+template<typename T> double selectMedian (T* values, int n);
+template<typename T> double quantile (const std::vector<T>& elements, double q);
+template<typename T> double median (const std::vector<T>& elements);
+
+// Medians of many groups at once: group g is values[offsets[g]] ..
+// values[offsets[g + 1] - 1]. The values are reordered.
+void batchMedians (double* values, const int* offsets, int groups, double* medians);
+
+parametricLine leastSquaresLine(const std::vector<int>& areas);
+parametricLine leastMedianSquaresLine(const std::vector<int>& areas, float p, float t,
+                                      unsigned seed = LMS_SEED, bool parallel = false);
 
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <vector>
+#include <atomic>
+#include <memory>
+
 class UnionFind
 {
-    int *id, cnt, *sz;
+    std::vector<int> id, sz;
+    int cnt;
 
     public:
         // Create an empty union find data structure with N isolated sets.
-        UnionFind(int N);
-        ~UnionFind();
+        UnionFind(int N = 0);
+
+        // Add a new isolated set and return its id (= the old size).
+        int add();
+
+        // Number of objects (not sets).
+        int size();
 
         // Return the id of component corresponding to object p.
         int find(int p);
@@ -21,3 +31,38 @@ class UnionFind
         // Return the number of disjoint sets.
         int count();
 };
+
+// Union find that can be used by several threads at the same time
+// without locks. Roots are linked with compare-and-swap, always the
+// root with the larger id below the one with the smaller id, so ids
+// only ever get smaller along a path; find() halves the paths it
+// walks. The number of objects is fixed.
+class ConcurrentUnionFind
+{
+    std::unique_ptr<std::atomic<int>[]> id;
+    int n;
+    std::atomic<int> cnt;
+
+    public:
+        // Create a union find data structure with N isolated sets.
+        ConcurrentUnionFind(int N = 0);
+
+        // Start over with N isolated sets (not thread-safe).
+        void reset(int N);
+
+        // Number of objects (not sets).
+        int size();
+
+        // Return the id of component corresponding to object p
+        // (the smallest id of its set once all merges are done).
+        int find(int p);
+
+        // Replace sets containing x and y with their union.
+        void merge(int x, int y);
+
+        // Are objects x and y in the same set?
+        bool connected(int x, int y);
+
+        // Return the number of disjoint sets.
+        int count();
+};
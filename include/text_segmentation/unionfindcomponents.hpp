@@ -4,5 +4,17 @@
 
 #include "include/opencvincludes.hpp"
 #include "include/text_segmentation/connectedcomponent.hpp"
+#include "include/text_segmentation/areafilter.hpp"
 
-void unionFindComponents(cv::Mat* input, std::vector<ConnectedComponent>* components, int minPx);
+// Image sides for the seamSides mask of unionFindComponents
+#define SIDE_TOP 1
+#define SIDE_BOTTOM 2
+#define SIDE_LEFT 4
+#define SIDE_RIGHT 8
+
+bool touchesSides (cv::Vec2i mbr_min, cv::Vec2i mbr_max, int sides, int rows, int cols);
+int unionFindComponents(cv::Mat* input, std::vector<ConnectedComponent>* components, int minPx,
+                        int seamSides = 0, cv::Mat* labelImage = NULL, std::vector<PixelRun>* runs = NULL);
+int relabelRegions(cv::Mat* input, cv::Mat* labelImage, int numLabels, std::vector<ConnectedComponent>* components,
+                   const std::vector<cv::Rect>& modified, int minPx = 0,
+                   const ComponentFilter& filter = ComponentFilter());
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+
+// Instruction sets the threshold kernels can use
+#define KERNEL_SCALAR 0
+#define KERNEL_SSE2 1
+#define KERNEL_AVX2 2
+
+// The best instruction set the CPU supports, capped
+// by setThresholdKernelLevel (e.g. for benchmarks).
+int thresholdKernelLevel();
+void setThresholdKernelLevel(int maxLevel);
+
+long long thresholdBGR (const cv::Mat& input, cv::Vec3b thresholds, uchar inside, uchar outside, cv::Mat* output);
+long long thresholdGray (const cv::Mat& input, int threshold, uchar below, uchar above, cv::Mat* output);
+
+void channelMaximum (const cv::Mat& input, cv::Mat* output, long long* histogram = NULL);
+int otsuThreshold (const long long* histogram);
+
+long long eraseLabel (const cv::Mat& labels, int label, cv::Rect area, cv::Mat* image);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/connectedcomponent.hpp"
+
+#include <string>
+#include <vector>
+
+std::vector<cv::Rect> tileGrid (cv::Size sheet, int tileSize);
+
+void tiledComponents (cv::Mat* blacklayer, std::vector<ConnectedComponent>* components, int minPx, int tileSize);
+void tiledTextRemoval (cv::Mat* blacklayer, const std::vector<ConnectedComponent>& components);
+void tiledVectorize (cv::Mat* blacklayer, std::string filename, double epsilon, int tileSize, int overlap);
@@ -3,7 +3,7 @@
 #include "include/opencvincludes.hpp"
 #include<vector>
 
-void getBlackLayer(cv::Vec3b thresholds, cv::Mat input, cv::Mat* output);
+void getBlackLayer(cv::Vec3b thresholds, const cv::Mat& input, cv::Mat* output);
 void negateBlackLayer(int threshold,cv::Mat* input, cv::Mat* output);
 void getWhiteLayer(int threshold, cv::Mat* input, cv::Mat* output);
 
@@ -1,11 +1,12 @@
 #pragma once
 
 #include "include/opencvincludes.hpp"
+#include "include/binaryimage.hpp"
 #include "include/vectorization/vectorline.hpp"
 #include <vector>
 #include <set>
 
-uint8_t encodeNeighbors (cv::Mat* image, cv::Vec2i curPixel);
+uint8_t encodeNeighbors (const BinaryImage& image, pixel* curPixel);
 void addToTable (std::vector<int>* neighborhoods, int *ruleTable, int rule);
 void initRuleTable(int* ruleTable);
 void initPixels(std::vector<vectorLine*>* pixels, cv::Mat* image);
@@ -18,7 +18,16 @@ struct colorPoly
 
 typedef struct colorPoly colorPoly;
 
+// A refined vector path in image coordinates together
+// with the local line width at each of its nodes.
+struct VectorPath
+{
+    std::vector<cv::Vec2i> nodes; // (row, col)
+    std::vector<double> widths;
+};
+
 
 void vectorizeImage (cv::Mat *blacklayer, cv::Mat *original_image, std::string filename, double epsilon);
-std::vector<std::vector<pixel*>> refineVectors(cv::Mat *image, std::map<pixel*, vectorLine*>* nodeToLine, std::vector<pixel *> *pixels, double epsilon);
-void vectorsToFile (cv::Mat *image, std::vector<std::vector<pixel*>> paths, std::vector<colorPoly> colorpolys, std::string filename);
+std::vector<VectorPath> vectorizeRegion (cv::Mat* blacklayer, cv::Rect region, double epsilon, cv::Mat* thinnedOut = NULL);
+std::vector<std::vector<pixel*>> refineVectors(cv::Mat *image, std::multimap<pixel*, vectorLine*>* nodeToLine, std::vector<pixel *> *pixels, double epsilon);
+void vectorsToFile (std::vector<VectorPath> paths, std::vector<colorPoly> colorpolys, cv::Size size, std::string filename);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "include/opencvincludes.hpp"
+#include "include/binaryimage.hpp"
 
 void thinningIteration(cv::Mat& im, int iter);
 void thinning(cv::Mat& im);
+void thinning(BinaryImage& im);
@@ -0,0 +1,156 @@
+/**
+  * Central place for all intermediate result windows and
+  * debug image files, so they can be switched off for
+  * headless (batch) runs.
+  *
+  * Debug images are encoded and written by a background
+  * thread so the pipeline doesn't wait for the disk.
+  *
+  * Author: phugen
+  */
+
+#include "include/debugview.hpp"
+
+#ifndef NO_DEBUG_VIEW
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace cv;
+
+
+// most images waiting for the writer at once;
+// debugWrite blocks while the queue is full
+#define MAX_PENDING_WRITES 4
+
+static bool debugView = true;
+static bool windowsShown = false;
+
+// Writes queued debug images on its own thread.
+// The thread is started with the first image.
+class DebugWriter
+{
+public:
+    DebugWriter() : busy(false), stop(false) {}
+
+    ~DebugWriter()
+    {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stop = true;
+        }
+
+        changed.notify_all();
+
+        if(worker.joinable())
+            worker.join();
+    }
+
+    void push(const string& filename, const Mat& image)
+    {
+        unique_lock<mutex> lock(queueMutex);
+
+        if(!worker.joinable())
+            worker = thread(&DebugWriter::run, this);
+
+        changed.wait(lock, [this] { return pending.size() < MAX_PENDING_WRITES; });
+        pending.push_back(make_pair(filename, image));
+        changed.notify_all();
+    }
+
+    // wait until all queued images are on disk
+    void flush()
+    {
+        unique_lock<mutex> lock(queueMutex);
+        changed.wait(lock, [this] { return pending.empty() && !busy; });
+    }
+
+private:
+    void run()
+    {
+        unique_lock<mutex> lock(queueMutex);
+
+        while(true)
+        {
+            changed.wait(lock, [this] { return stop || !pending.empty(); });
+
+            if(pending.empty())
+                return;
+
+            pair<string, Mat> next = pending.front();
+            pending.pop_front();
+            busy = true;
+            changed.notify_all();
+
+            lock.unlock();
+            imwrite(next.first, next.second);
+            lock.lock();
+
+            busy = false;
+            changed.notify_all();
+        }
+    }
+
+    mutex queueMutex;
+    condition_variable changed;
+    deque<pair<string, Mat>> pending;
+    thread worker;
+    bool busy;
+    bool stop;
+};
+
+static DebugWriter& debugWriter()
+{
+    static DebugWriter writer;
+    return writer;
+}
+
+void setDebugView(bool enabled)
+{
+    debugView = enabled;
+}
+
+bool debugViewEnabled()
+{
+    return debugView;
+}
+
+// Shows an intermediate result in its own window.
+void debugShow(const string& window, const Mat& image, int flags)
+{
+    if(!debugView)
+        return;
+
+    namedWindow(window, flags);
+    imshow(window, image);
+    windowsShown = true;
+}
+
+// Queues an intermediate result for writing to disk.
+// The image is copied, so the caller may keep changing it.
+void debugWrite(const string& filename, const Mat& image)
+{
+    if(!debugView)
+        return;
+
+    debugWriter().push(filename, image.clone());
+}
+
+// Waits for a key press if any debug window is open.
+void debugWait()
+{
+    if(!debugView || !windowsShown)
+        return;
+
+    waitKey(0);
+}
+
+void flushDebugWrites()
+{
+    debugWriter().flush();
+}
+
+#endif // NO_DEBUG_VIEW
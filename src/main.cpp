@@ -2,21 +2,53 @@
   * A program that takes an image, deletes text from it
   * and then tries to convert it into a vector representation.
   *
+  * Usage:
+  *   cityplan_vectorization [image]
+  *       Interactive run on one plan; shows all intermediate results.
+  *
+  *   cityplan_vectorization --batch <input directory | file list> <output directory>
+  *       Headless run over many plans; opens no windows and prints
+  *       one status line per plan. Exits with 1 if any plan failed.
+  *
+  *   Options (before any of the above):
+  *   --tile <size>
+  *       Processes very large scans in tiles of size x size pixels,
+  *       so all stages but the black layer (one byte per pixel of
+  *       the scan) only need memory for one tile at a time.
+  *   --jobs <n>
+  *       Batch mode: processes n plans at the same time. The messages
+  *       of each plan then go to "<output>.log".
+  *   --resident <k>
+  *       Batch mode: keeps at most k plans in memory at once
+  *       (default: one per job).
+  *   --no-debug
+  *       Interactive run without intermediate result windows
+  *       and debug images (builds with NO_DEBUG_VIEW never
+  *       produce them).
+  *   --colors
+  *       Also converts the colored areas of the plan to filled
+  *       polygons. Without it, PPM/PGM and BMP plans are decoded
+  *       in row strips and the color image is never kept.
+  *   --threshold <t>
+  *       Pixels with all channels <= t (1 .. 255) are black
+  *       (default: 180).
+  *   --auto-threshold
+  *       Chooses the black threshold for each plan from its
+  *       brightness histogram (Otsu) instead.
+  *
+  *   Every run also writes "<output>.timing.json" with the time and
+  *   work counters (pixels, components, lines, ...) of each stage.
+  *
   * Author: phugen
   */
 
 #include "include/opencvincludes.hpp"
-#include "include/text_segmentation/auxiliary.hpp"
-#include "include/text_segmentation/unionfindcomponents.hpp"
-#include "include/text_segmentation/areafilter.hpp"
-#include "include/text_segmentation/collineargrouping.hpp"
-#include "include/vectorization/zhangsuen.hpp"
-#include "include/vectorization/vectorize.hpp"
-#include "include/vectorization/iterative_linematching.hpp"
+#include "include/pipeline.hpp"
+#include "include/debugview.hpp"
 
 #include <iostream>
-#include <algorithm>
-#include <time.h>
+#include <string>
+#include <cstdlib>
 
 
 using namespace std;
@@ -25,38 +57,87 @@ using namespace cv;
 
 int main (int argc, char** argv)
 {
-    int start_time = time(NULL);
-
-
-    Mat original, process, output;
-    vector<ConnectedComponent> components;
-
-    // load image here
-    original = imread("../../cityplan_vectorization/presentation_IMAGE.png");
+    PipelineOptions options;
 
-    if(!original.data)
+    // strip leading options ("--name <number>", "--no-debug", "--colors", "--auto-threshold") from the arguments
+    while(argc > 1 && string(argv[1]).compare(0, 2, "--") == 0 && string(argv[1]) != "--batch")
     {
-        cout << "The image couldn't be loaded. Maybe the file name was wrong?\n";
-        return -1;
+        string option = argv[1];
+
+        if(option == "--no-debug" || option == "--colors" || option == "--auto-threshold")
+        {
+            if(option == "--no-debug")
+                setDebugView(false);
+            else if(option == "--colors")
+                options.recoverColors = true;
+            else
+                options.autoThreshold = true;
+
+            argv[1] = argv[0];
+            argv++;
+            argc--;
+            continue;
+        }
+
+        int value = argc > 2 ? atoi(argv[2]) : 0;
+
+        if(value <= 0)
+        {
+            cout << option << " needs a positive number.\n";
+            return 2;
+        }
+
+        if(option == "--tile")
+            options.tileSize = value;
+        else if(option == "--jobs")
+            options.workers = value;
+        else if(option == "--resident")
+            options.maxResident = value;
+        else if(option == "--threshold" && value <= 255)
+            options.thresholds = Vec3b(value, value, value);
+        else
+        {
+            cout << "Unknown option " << option << "\n";
+            return 2;
+        }
+
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
     }
 
-    process = original.clone();
-    output = Mat(original.rows, original.cols, CV_8U); // output matrix
+    // batch mode: many plans, no windows
+    if(argc > 1 && string(argv[1]) == "--batch")
+    {
+        if(argc != 4)
+        {
+            cout << "Usage: " << argv[0] << " --batch <input directory | file list> <output directory>\n";
+            return 2;
+        }
 
-    cout << original.depth() << " " << original.channels() << "\n";
+        vector<string> files = collectInputFiles(argv[2]);
 
+        if(files.empty())
+        {
+            cout << "No plans found in " << argv[2] << "\n";
+            return 2;
+        }
 
-    // TODO: Automatically choosing reasonable threshold?
-    Vec3b thresholds = Vec3b(180, 180, 180);
+        return runBatch(files, argv[3], options) == 0 ? 0 : 1;
+    }
 
-    getBlackLayer(thresholds, process, &output); // black layer creation
-    unionFindComponents(&output, &components, 10); // MBR detection
-    areaFilter(&components, 10); // ratio component filtering
-    collinearGrouping(output, &output, &components); // text removal
-    vectorizeImage(&output, &original, "vectorized", 2); // vectorization of image
+    // load image here
+    string input = "../../cityplan_vectorization/presentation_IMAGE.png";
+    if(argc > 1)
+        input = argv[1];
+
+    double elapsedMs = 0;
+
+    if(processPlan(input, "vectorized", options, &elapsedMs) != 0)
+        return -1;
 
-    int end_time = time(NULL);
-    printf ("\n\nVectorizing this file took %d second(s)!\n", (end_time - start_time));
+    printf ("\n\nVectorizing this file took %.3f second(s)! (per stage: vectorized.timing.json)\n", elapsedMs / 1000.);
 
-    waitKey(0);
+    flushDebugWrites();
+    debugWait();
 }
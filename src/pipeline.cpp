@@ -0,0 +1,380 @@
+/**
+  * Runs the complete pipeline (black layer extraction, text removal
+  * and vectorization) on single plans or on whole batches of plans.
+  *
+  * Author: phugen
+  */
+
+#include "include/pipeline.hpp"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/tiling.hpp"
+#include "include/pipelinelog.hpp"
+#include "include/text_segmentation/auxiliary.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/areafilter.hpp"
+#include "include/text_segmentation/collineargrouping.hpp"
+#include "include/vectorization/vectorize.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace cv;
+
+
+PipelineOptions::PipelineOptions()
+{
+    thresholds = Vec3b(180, 180, 180);
+    autoThreshold = false;
+    minPx = 10;
+    ratio = 10;
+    epsilon = 2;
+    timingReport = true;
+    tileSize = 0;
+    tileOverlap = 32;
+    workers = 1;
+    maxResident = 0;
+    recoverColors = false;
+}
+
+// Runs text removal and vectorization on a black layer and writes the
+// result to "outputFile.svg". Color polygons are only recovered if the
+// original color image is given. Stage times and counters go to the
+// active profiler of the calling thread.
+static void processBlackLayer (Mat* blacklayer, Mat* original, const string& outputFile, const PipelineOptions& options)
+{
+    vector<ConnectedComponent> components;
+
+    // Large scans: label, remove text and vectorize tile by tile;
+    // only the black layer is kept for the whole sheet
+    if(options.tileSize > 0)
+    {
+        tiledComponents(blacklayer, &components, options.minPx, options.tileSize); // MBR detection
+        areaFilter(&components, options.ratio); // ratio component filtering
+        tiledTextRemoval(blacklayer, components); // text removal
+        tiledVectorize(blacklayer, outputFile, options.epsilon, options.tileSize, options.tileOverlap); // vectorization of image
+    }
+
+    else
+    {
+        Mat labels; // component of each pixel, for erasing components
+
+        unionFindComponents(blacklayer, &components, options.minPx, 0, &labels); // MBR detection
+        areaFilter(&components, options.ratio); // ratio component filtering
+        collinearGrouping(*blacklayer, blacklayer, &components, &labels); // text removal
+        vectorizeImage(blacklayer, original, outputFile, options.epsilon); // vectorization of image
+    }
+}
+
+// Extracts the black layer with the fixed thresholds of the options,
+// or with a threshold chosen from the image if autoThreshold is set.
+static void makeBlackLayer (const Mat& original, Mat* blacklayer, const PipelineOptions& options, const string& name = "")
+{
+    if(!options.autoThreshold)
+    {
+        getBlackLayer(options.thresholds, original, blacklayer);
+        return;
+    }
+
+    Vec3b chosen = getAutoBlackLayer(original, blacklayer);
+
+    if(!name.empty())
+        pipelineLog() << "Black threshold for " << name << ": " << (int) chosen[0] << "\n";
+}
+
+// Runs the whole pipeline on an image that is already loaded.
+void processImage (const Mat& original, const string& outputFile, const PipelineOptions& options)
+{
+    Mat blacklayer;
+    Mat colors = original; // shares the pixels; only read by the color recovery
+
+    makeBlackLayer(original, &blacklayer, options); // black layer creation
+    processBlackLayer(&blacklayer, options.recoverColors ? &colors : NULL, outputFile, options);
+}
+
+// Vectorizes a single plan and writes the result to "outputFile.svg".
+// If enabled, the time and work counters of every stage are written
+// to "outputFile.timing.json". The total run time in milliseconds is
+// stored in elapsedMs if it isn't NULL.
+// Returns 0 on success, -1 if the image couldn't be loaded.
+int processPlan (const string& inputFile, const string& outputFile, const PipelineOptions& options, double* elapsedMs)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    StageProfiler profiler;
+    Mat original, blacklayer;
+
+    // a plan that throws must not leave a dangling profiler behind
+    struct ProfilerGuard
+    {
+        ProfilerGuard(StageProfiler* p) { setActiveProfiler(p); }
+        ~ProfilerGuard() { setActiveProfiler(NULL); }
+    } guard(&profiler);
+
+    // Without color recovery, only the black layer is needed: build it
+    // while decoding if the format allows it, so the color image is
+    // never fully in memory. Otherwise, load the image here.
+    Vec3b chosen;
+
+    if(!options.recoverColors && streamBlackLayer(inputFile, options.thresholds, &blacklayer, 256, options.autoThreshold, &chosen))
+    {
+        if(options.autoThreshold)
+            pipelineLog() << "Black threshold for " << inputFile << ": " << (int) chosen[0] << "\n";
+    }
+
+    else
+    {
+        {
+            ScopedStageTimer timer("imread");
+            original = imread(inputFile);
+            countStage("imread", "pixels", (long long) original.rows * original.cols);
+        }
+
+        if(!original.data)
+        {
+            pipelineLog() << "The image couldn't be loaded. Maybe the file name was wrong?\n";
+            return -1;
+        }
+
+        makeBlackLayer(original, &blacklayer, options, inputFile); // black layer creation
+
+        if(!options.recoverColors)
+            original.release();
+    }
+
+    processBlackLayer(&blacklayer, options.recoverColors ? &original : NULL, outputFile, options);
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    if(elapsedMs != NULL)
+        *elapsedMs = elapsed.count();
+
+    if(options.timingReport)
+    {
+        if(!profiler.writeJSON(outputFile + ".timing.json", inputFile, elapsed.count()))
+            pipelineLog() << "processPlan: Couldn't write " << outputFile << ".timing.json\n";
+    }
+
+    return 0;
+}
+
+// Lower-case file extension of a path, without the dot.
+static string fileExtension (const string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+
+    if(dot == string::npos || (slash != string::npos && dot < slash))
+        return "";
+
+    string ext = path.substr(dot + 1);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    return ext;
+}
+
+static bool isImageFile (const string& path)
+{
+    static const char* known[] = { "png", "jpg", "jpeg", "tif", "tiff", "bmp", "pbm", "pgm", "ppm" };
+    string ext = fileExtension(path);
+
+    for(size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+        if(ext == known[i])
+            return true;
+
+    return false;
+}
+
+// Returns all plans named by "source", which is either
+// a directory (all images in it) or a text file that
+// lists one image path per line.
+vector<string> collectInputFiles (const string& source)
+{
+    vector<string> files;
+    struct stat info;
+
+    if(stat(source.c_str(), &info) != 0)
+    {
+        cout << "collectInputFiles: " << source << " does not exist!\n";
+        return files;
+    }
+
+    // directory: take every image inside
+    if(S_ISDIR(info.st_mode))
+    {
+        vector<String> found;
+        glob(source, found, false);
+
+        for(auto f = found.begin(); f != found.end(); f++)
+            if(isImageFile(*f))
+                files.push_back(*f);
+
+        sort(files.begin(), files.end());
+    }
+
+    // file list: one path per line, '#' starts a comment
+    else
+    {
+        ifstream list(source.c_str());
+        string line;
+
+        while(getline(list, line))
+        {
+            // strip trailing whitespace (and Windows line endings)
+            line.erase(line.find_last_not_of(" \t\r\n") + 1);
+
+            if(line.empty() || line[0] == '#')
+                continue;
+
+            files.push_back(line);
+        }
+    }
+
+    return files;
+}
+
+// Output base name (without ".svg") for a plan: the input
+// file name without its extension, placed in outputDir.
+string outputNameFor (const string& inputFile, const string& outputDir)
+{
+    size_t slash = inputFile.find_last_of("/\\");
+    string name = (slash == string::npos) ? inputFile : inputFile.substr(slash + 1);
+
+    size_t dot = name.find_last_of('.');
+    if(dot != string::npos)
+        name = name.substr(0, dot);
+
+    if(outputDir.empty())
+        return name;
+
+    char last = outputDir[outputDir.size() - 1];
+    if(last == '/' || last == '\\')
+        return outputDir + name;
+
+    return outputDir + "/" + name;
+}
+
+// Counting semaphore that limits how many plans
+// (i.e. decoded images) are in memory at once.
+class ResidentSlots
+{
+public:
+    ResidentSlots(int slots)
+    {
+        this->free = slots;
+    }
+
+    void acquire()
+    {
+        unique_lock<mutex> lock(m);
+        released.wait(lock, [this] { return free > 0; });
+        free--;
+    }
+
+    void release()
+    {
+        {
+            lock_guard<mutex> lock(m);
+            free++;
+        }
+
+        released.notify_one();
+    }
+
+private:
+    mutex m;
+    condition_variable released;
+    int free;
+};
+
+// Processes all plans without opening any windows, on a pool of
+// options.workers threads. At most options.maxResident plans are
+// loaded at the same time; the other workers wait for a free slot.
+//
+// With more than one worker, the progress messages of each plan go
+// to "<output>.log" instead of the console. Prints one status line
+// per plan and returns the number of plans that failed.
+int runBatch (const vector<string>& inputFiles, const string& outputDir, const PipelineOptions& options)
+{
+    int workers = max(1, min(options.workers, (int) inputFiles.size()));
+    int resident = (options.maxResident > 0) ? options.maxResident : workers;
+
+    ResidentSlots slots(resident);
+    atomic<size_t> next(0); // next plan to be taken by a worker
+    atomic<int> failed(0);
+    mutex statusMutex; // keeps status lines whole
+
+    setDebugView(false);
+
+    auto work = [&]()
+    {
+        size_t i;
+
+        while((i = next++) < inputFiles.size())
+        {
+            const string& file = inputFiles[i];
+            string outputFile = outputNameFor(file, outputDir);
+            double elapsedMs = 0;
+            int status;
+
+            ofstream log;
+
+            if(workers > 1)
+            {
+                log.open((outputFile + ".log").c_str());
+                setPipelineLog(&log);
+            }
+
+            slots.acquire();
+
+            // a broken sheet must not stop the whole batch
+            try
+            {
+                status = processPlan(file, outputFile, options, &elapsedMs);
+            }
+            catch(const exception& e)
+            {
+                pipelineLog() << "processPlan: " << e.what() << "\n";
+                status = -1;
+            }
+
+            slots.release();
+            setPipelineLog(NULL);
+
+            lock_guard<mutex> lock(statusMutex);
+
+            if(status == 0)
+                cout << "[OK] " << file << " -> " << outputFile << ".svg (" << (elapsedMs / 1000.) << "s)\n";
+            else
+            {
+                cout << "[FAILED] " << file << "\n";
+                failed++;
+            }
+        }
+    };
+
+    if(workers == 1)
+        work();
+
+    else
+    {
+        vector<thread> pool;
+
+        for(int w = 0; w < workers; w++)
+            pool.push_back(thread(work));
+
+        for(auto t = pool.begin(); t != pool.end(); t++)
+            (*t).join();
+    }
+
+    cout << "\n" << (inputFiles.size() - failed) << " of " << inputFiles.size() << " plan(s) vectorized, " << failed << " failed.\n";
+
+    return failed;
+}
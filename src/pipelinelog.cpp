@@ -0,0 +1,26 @@
+/**
+  * Per-thread progress output of the pipeline, so plans that
+  * are processed at the same time don't mix their messages.
+  *
+  * Author: phugen
+  */
+
+#include "include/pipelinelog.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+
+static thread_local ostream* logStream = NULL;
+
+ostream& pipelineLog()
+{
+    return (logStream != NULL) ? *logStream : cout;
+}
+
+// NULL switches back to std::cout.
+void setPipelineLog(ostream* stream)
+{
+    logStream = stream;
+}
@@ -0,0 +1,281 @@
+/**
+  * High resolution timing and work counters for the pipeline stages.
+  * Results are written as one JSON report per image.
+  *
+  * Author: phugen
+  */
+
+#include "include/stageprofiler.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace std;
+
+
+// each thread reports to its own profiler
+static thread_local StageProfiler* active = NULL;
+
+void setActiveProfiler(StageProfiler* profiler)
+{
+    active = profiler;
+}
+
+StageProfiler* activeProfiler()
+{
+    return active;
+}
+
+void countStage(const string& stage, const string& counter, long long value)
+{
+    if(active != NULL)
+        active->addCounter(stage, counter, value);
+}
+
+
+// Reads the resident set high water mark. On Linux, /proc/self/status
+// has one that can be reset, getrusage() is the fallback.
+long long peakResidentBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+
+    return (long long) counters.PeakWorkingSetSize;
+#else
+    ifstream status("/proc/self/status");
+    string line;
+
+    while(getline(status, line))
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return atoll(line.c_str() + 6) * 1024; // in kB
+
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    #if defined(__APPLE__)
+        return (long long) usage.ru_maxrss; // in bytes
+    #else
+        return (long long) usage.ru_maxrss * 1024; // in kB
+    #endif
+#endif
+}
+
+// Sets the high water mark back to the current resident memory,
+// so the next peak belongs to the code that runs after it.
+bool resetPeakResident()
+{
+#if defined(__linux__)
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+
+    return clearRefs.good();
+#else
+    return false;
+#endif
+}
+
+
+StageProfiler::StageProfiler()
+    : trackMemory(false)
+{}
+
+StageProfiler::StageRecord* StageProfiler::record(const string& stage)
+{
+    for(auto s = stages.begin(); s != stages.end(); s++)
+        if((*s).name == stage)
+            return &(*s);
+
+    StageRecord rec;
+    rec.name = stage;
+    rec.ms = 0.;
+    rec.calls = 0;
+    rec.peakBytes = -1;
+    stages.push_back(rec);
+
+    return &stages.back();
+}
+
+// Repeated calls of the same stage are summed up.
+void StageProfiler::addTime(const string& stage, double ms)
+{
+    StageRecord* rec = record(stage);
+    rec->ms += ms;
+    rec->calls++;
+}
+
+// Repeated counts for the same stage and counter are summed up.
+void StageProfiler::addCounter(const string& stage, const string& counter, long long value)
+{
+    StageRecord* rec = record(stage);
+
+    for(auto c = rec->counters.begin(); c != rec->counters.end(); c++)
+        if((*c).first == counter)
+        {
+            (*c).second += value;
+            return;
+        }
+
+    rec->counters.push_back(make_pair(counter, value));
+}
+
+// Repeated calls of the same stage keep the highest peak.
+void StageProfiler::addPeakMemory(const string& stage, long long bytes)
+{
+    StageRecord* rec = record(stage);
+    rec->peakBytes = max(rec->peakBytes, bytes);
+}
+
+void StageProfiler::clear()
+{
+    stages.clear();
+}
+
+void StageProfiler::setTrackMemory(bool enabled)
+{
+    trackMemory = enabled;
+}
+
+bool StageProfiler::tracksMemory() const
+{
+    return trackMemory;
+}
+
+const vector<StageProfiler::StageRecord>& StageProfiler::records() const
+{
+    return stages;
+}
+
+// Sub-stages are named "stage/substage" and are
+// already contained in the time of their parent.
+double StageProfiler::totalTime() const
+{
+    double total = 0.;
+
+    for(auto s = stages.begin(); s != stages.end(); s++)
+        if((*s).name.find('/') == string::npos)
+            total += (*s).ms;
+
+    return total;
+}
+
+// Escapes the characters JSON doesn't allow in strings:
+// quotes, backslashes and control characters (\u00XX).
+string jsonString (const string& s)
+{
+    static const char hex[] = "0123456789abcdef";
+    string out = "\"";
+
+    for(size_t i = 0; i < s.size(); i++)
+    {
+        unsigned char c = s[i];
+
+        if(c < 0x20)
+        {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+            continue;
+        }
+
+        if(c == '"' || c == '\\')
+            out += '\\';
+
+        out += c;
+    }
+
+    return out + "\"";
+}
+
+// "totalMs" is the wall time of the run, "stagesMs" the sum of the
+// top-level stage times; the difference is the untimed work.
+string StageProfiler::toJSON(const string& image, double totalMs) const
+{
+    ostringstream json;
+    json << fixed << setprecision(3);
+
+    json << "{\n";
+    json << "  \"image\": " << jsonString(image) << ",\n";
+    json << "  \"totalMs\": " << totalMs << ",\n";
+    json << "  \"stagesMs\": " << totalTime() << ",\n";
+    json << "  \"stages\": [";
+
+    for(size_t i = 0; i < stages.size(); i++)
+    {
+        const StageRecord& rec = stages[i];
+
+        json << (i == 0 ? "\n" : ",\n");
+        json << "    { \"name\": " << jsonString(rec.name)
+             << ", \"ms\": " << rec.ms
+             << ", \"calls\": " << rec.calls;
+
+        if(rec.peakBytes >= 0)
+            json << ", \"peakRSS\": " << rec.peakBytes;
+
+        json << ", \"counters\": {";
+
+        for(size_t c = 0; c < rec.counters.size(); c++)
+            json << (c == 0 ? " " : ", ") << jsonString(rec.counters[c].first) << ": " << rec.counters[c].second;
+
+        json << (rec.counters.empty() ? "} }" : " } }");
+    }
+
+    json << "\n  ]\n}\n";
+
+    return json.str();
+}
+
+bool StageProfiler::writeJSON(const string& filename, const string& image, double totalMs) const
+{
+    ofstream file(filename.c_str());
+
+    if(!file)
+        return false;
+
+    file << toJSON(image, totalMs);
+
+    return file.good();
+}
+
+
+ScopedStageTimer::ScopedStageTimer(const string& stage)
+{
+    this->stage = stage;
+
+    // a top-level stage starts with a fresh memory peak;
+    // sub-stages share the peak of their parent
+    if(active != NULL && active->tracksMemory() && stage.find('/') == string::npos)
+        resetPeakResident();
+
+    this->start = chrono::steady_clock::now();
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    if(active == NULL)
+        return;
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    active->addTime(stage, elapsed.count());
+
+    if(active->tracksMemory())
+        active->addPeakMemory(stage, peakResidentBytes());
+}
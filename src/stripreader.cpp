@@ -0,0 +1,190 @@
+/**
+  * Row strip decoding for uncompressed image formats, so the
+  * black layer of very large scans can be built without
+  * loading the whole color image first.
+  *
+  * Author: phugen
+  */
+
+#include "include/stripreader.hpp"
+
+#include <cctype>
+#include <cstring>
+
+using namespace std;
+using namespace cv;
+
+
+StripReader::StripReader()
+    : format(NONE), width(0), height(0), bottomUp(false), rowsRead(0), rowBytes(0)
+{}
+
+bool StripReader::open(const string& filename)
+{
+    file.open(filename.c_str(), ios::in | ios::binary);
+
+    if(!file)
+        return false;
+
+    char magic[2] = { 0, 0 };
+    file.read(magic, 2);
+
+    if(magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6'))
+    {
+        format = magic[1] == '5' ? PNM_GRAY : PNM_COLOR;
+        return openPNM();
+    }
+
+    if(magic[0] == 'B' && magic[1] == 'M')
+        return openBMP();
+
+    return false;
+}
+
+// Next number of a PNM header; skips white space and comments.
+static int pnmNumber (ifstream& file)
+{
+    int c = file.get();
+
+    while(c != EOF && (isspace(c) || c == '#'))
+    {
+        if(c == '#')
+            while(c != EOF && c != '\n')
+                c = file.get();
+
+        c = file.get();
+    }
+
+    int value = 0;
+    bool digits = false;
+
+    while(c != EOF && isdigit(c))
+    {
+        value = value * 10 + (c - '0');
+        digits = true;
+        c = file.get();
+    }
+
+    // c is the single white space that ends the number
+    return digits ? value : -1;
+}
+
+bool StripReader::openPNM()
+{
+    width = pnmNumber(file);
+    height = pnmNumber(file);
+    int maxValue = pnmNumber(file);
+
+    // other sample ranges (including 16 bit samples) are left to
+    // imread, so the thresholds always apply to 0 .. 255 values
+    if(width <= 0 || height <= 0 || maxValue != 255)
+        return false;
+
+    rowBytes = (size_t) width * (format == PNM_COLOR ? 3 : 1);
+    bottomUp = false;
+
+    return file.good();
+}
+
+static unsigned int littleEndian (const unsigned char* bytes, int count)
+{
+    unsigned int value = 0;
+
+    for(int i = count - 1; i >= 0; i--)
+        value = (value << 8) | bytes[i];
+
+    return value;
+}
+
+bool StripReader::openBMP()
+{
+    // file header (without "BM") and the start of the info header
+    unsigned char header[52];
+    file.read((char*) header, sizeof(header));
+
+    if(!file)
+        return false;
+
+    unsigned int dataOffset = littleEndian(header + 8, 4);
+    unsigned int infoSize = littleEndian(header + 12, 4);
+    int w = (int) littleEndian(header + 16, 4);
+    int h = (int) littleEndian(header + 20, 4);
+    unsigned int bitsPerPixel = littleEndian(header + 26, 2);
+    unsigned int compression = littleEndian(header + 28, 4);
+
+    // palettes, compression and bit fields are left to imread
+    if(infoSize < 40 || compression != 0 || (bitsPerPixel != 24 && bitsPerPixel != 32) || w <= 0 || h == 0)
+        return false;
+
+    format = bitsPerPixel == 24 ? BMP_24 : BMP_32;
+    width = w;
+    height = h < 0 ? -h : h;
+    bottomUp = h > 0;
+    rowBytes = (((size_t) width * bitsPerPixel + 31) / 32) * 4;
+
+    file.seekg(dataOffset);
+
+    return file.good();
+}
+
+int StripReader::read(int maxRows, Mat* strip, int* firstRow)
+{
+    int n = min(maxRows, height - rowsRead);
+
+    if(format == NONE || n <= 0)
+        return 0;
+
+    buffer.resize(rowBytes * n);
+    file.read((char*) buffer.data(), buffer.size());
+
+    if(!file)
+        return 0;
+
+    strip->create(n, width, CV_8UC3);
+
+    for(int r = 0; r < n; r++)
+    {
+        const unsigned char* src = &buffer[r * rowBytes];
+
+        // the file rows of a bottom-up BMP are in reverse order
+        uchar* dst = strip->ptr<uchar>(bottomUp ? n - 1 - r : r);
+
+        switch(format)
+        {
+            case PNM_GRAY:
+                for(int j = 0; j < width; j++)
+                    dst[3*j] = dst[3*j + 1] = dst[3*j + 2] = src[j];
+                break;
+
+            case PNM_COLOR: // RGB
+                for(int j = 0; j < width; j++)
+                {
+                    dst[3*j] = src[3*j + 2];
+                    dst[3*j + 1] = src[3*j + 1];
+                    dst[3*j + 2] = src[3*j];
+                }
+                break;
+
+            case BMP_24: // BGR
+                memcpy(dst, src, (size_t) width * 3);
+                break;
+
+            case BMP_32: // BGRA
+                for(int j = 0; j < width; j++)
+                {
+                    dst[3*j] = src[4*j];
+                    dst[3*j + 1] = src[4*j + 1];
+                    dst[3*j + 2] = src[4*j + 2];
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    *firstRow = bottomUp ? height - rowsRead - n : rowsRead;
+    rowsRead += n;
+
+    return n;
+}
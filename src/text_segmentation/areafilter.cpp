@@ -10,8 +10,11 @@
 #include "include/text_segmentation/areafilter.hpp"
 #include "include/text_segmentation/auxiliary.hpp"
 #include "include/text_segmentation/statistics.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
 
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -35,134 +38,238 @@ void printAreaValues (vector<ConnectedComponent> cluster)
     outputfile.close();
 }
 
+ComponentFilter& ComponentFilter::add(ComponentPredicate predicate)
+{
+    predicates.push_back(predicate);
+    return *this;
+}
+
+bool ComponentFilter::operator () (const ConnectedComponent& comp) const
+{
+    for(auto predicate = predicates.begin(); predicate != predicates.end(); predicate++)
+        if(!(*predicate)(comp))
+            return false;
+
+    return true;
+}
+
+ClusterFilter& ClusterFilter::add(ClusterStep step)
+{
+    steps.push_back(step);
+    return *this;
+}
+
+// The components the filter rejects are dropped from the view
+// in one pass; the order of the other ids is kept.
+ClusterFilter& ClusterFilter::add(const ComponentFilter& filter)
+{
+    return add([filter](const ComponentStore& store, vector<int>* ids)
+    {
+        auto end = remove_if(ids->begin(), ids->end(),
+                             [&filter, &store](int id) { return !filter(store.component(id)); });
+
+        ids->erase(end, ids->end());
+    });
+}
+
+void ClusterFilter::operator () (const ComponentStore& store, vector<int>* ids) const
+{
+    for(auto step = steps.begin(); step != steps.end(); step++)
+        (*step)(store, ids);
+}
+
+// Keeps components whose MBR side ratio is between 1:ratio and ratio:1.
+ComponentPredicate aspectRatioAtMost(int ratio)
+{
+    return [ratio](const ConnectedComponent& comp)
+    {
+        float x = (comp.mbr_max[0] + 1) - comp.mbr_min[0];
+        float y = (comp.mbr_max[1] + 1) - comp.mbr_min[1];
+
+        return !((ratio * x) < y || x > (ratio * y));
+    };
+}
+
+// Keeps components of which at least minDensity (0 .. 1) of the MBR pixels are black.
+ComponentPredicate densityAtLeast(double minDensity)
+{
+    return [minDensity](const ConnectedComponent& comp)
+    {
+        double pxInMBR = (double) ((comp.mbr_max[0] + 1) - comp.mbr_min[0]) * ((comp.mbr_max[1] + 1) - comp.mbr_min[1]);
+
+        return comp.numBlackPixels >= minDensity * pxInMBR;
+    };
+}
+
+// Keeps components with minArea <= MBR area <= maxArea.
+ComponentPredicate areaBetween(int minArea, int maxArea)
+{
+    return [minArea, maxArea](const ConnectedComponent& comp)
+    {
+        return comp.area >= minArea && comp.area <= maxArea;
+    };
+}
+
+// Removes the components the filter rejects in one pass,
+// keeping the order of the others.
+void filterComponents(vector<ConnectedComponent>* components, const ComponentFilter& filter)
+{
+    auto end = remove_if(components->begin(), components->end(),
+                         [&filter](const ConnectedComponent& comp) { return !filter(comp); });
+
+    components->erase(end, components->end());
+}
+
+// Returns the indices of the components the filter keeps,
+// without touching the components themselves.
+vector<int> selectComponents(const vector<ConnectedComponent>& components, const ComponentFilter& filter)
+{
+    vector<int> kept;
+
+    for(int i = 0; i < (int) components.size(); i++)
+        if(filter(components[i]))
+            kept.push_back(i);
+
+    return kept;
+}
+
 // Dismiss any components that have an area ratio
 // less than 1:ratio or larger than ratio:1 because they
 // are likely to not be characters.
 void areaFilter(vector<ConnectedComponent>* components, int ratio)
 {
-    vector<ConnectedComponent>::iterator iter = components->begin();
-    while (iter != components->end())
-    {
-        ConnectedComponent curr = *iter;
-
-        float x = (curr.mbr_max[0] + 1) - curr.mbr_min[0];
-        float y = (curr.mbr_max[1] + 1) - curr.mbr_min[1];
+    ScopedStageTimer timer("areaFilter");
+    countStage("areaFilter", "componentsIn", components->size());
 
-        // if the ratio is less than 1:ratio or larger than ratio:1
-        // consider this component a non-character component
-        if((ratio * x) < y || x > (ratio * y))
-            iter = components->erase(iter);
-
-        else
-            iter++;
-    }
+    filterComponents(components, ComponentFilter().add(aspectRatioAtMost(ratio)));
 
     //cout << "#Components after area filter: " << components->size() << "\n";
+    countStage("areaFilter", "componentsOut", components->size());
 
     // show result
     //namedWindow("AREA FILTER", WINDOW_AUTOSIZE);
     //imshow("AREA FILTER", input);
 }
 
-// Auxiliary function for sorting a container of ConnectedComponents
+// Auxiliary functor for sorting a list of component ids
 // by the area sizes of the component MBRs.
-bool sortByMBRArea (ConnectedComponent a, ConnectedComponent b)
+struct sortByMBRArea
 {
-    return a.area < b.area;
-}
+    const ComponentStore& store;
 
-// Remove components from this cluster until the ratio from the largest
-// to the smallest is equal to or smaller than the input ratio (or the
-// cluster consists of only one element).
-void clusterCompAreaFilter(vector<ConnectedComponent>* cluster, double maxError)
-{
-    // Nonsensical error
-    if(maxError < 0)
+    sortByMBRArea(const ComponentStore& store) : store(store) {}
+
+    bool operator () (int a, int b) const
     {
-      cout << "clusterCompAreaFilter: maxError " << maxError << " is < 0!\n";
-      assert(maxError < 0);
+        return store.area[a] < store.area[b];
     }
+};
 
-    // no ratio filtering needed
-    if(cluster->size() == 0 || cluster->size() == 1)
-        return;
-
-    // sort list by MBR area sizes
-    sort(cluster->begin(), cluster->end(), sortByMBRArea);
-
+// LMS outlier rejection: fits a line to the (ascending) areas by Least
+// Median Squares and drops areas from both ends while their error is
+// above maxError. The areas at first .. last (inclusive) are kept.
+void areaInlierRange(const vector<int>& areas, double maxError, int* first, int* last)
+{
     // Calculate Least Median Squares-approved line parameters
-    parametricLine line = leastMedianSquaresLine(*cluster, 0.9999, 0.1);
-
-    auto to = cluster->begin();
-    auto from = cluster->end() - 1;
-    bool deleted = true;
+    parametricLine line = leastMedianSquaresLine(areas, 0.9999, 0.1, LMS_SEED, areas.size() >= LMS_PARALLEL_MIN_SIZE);
 
     int posTo = 0;
-    int posFrom = cluster->size() - 1;
+    int posFrom = areas.size() - 1;
+    bool deleted = true;
 
     // delete all outliers based on their area error
     // compared to the LMS-fitted function.
-    while(to != from && deleted != false)
+    while(posTo != posFrom && deleted != false)
     {
-        double lowError = abs((*to).area - line.m * posTo + line.b);
-        double highError = abs((*from).area - line.m * posFrom + line.b);
+        double lowError = abs(areas[posTo] - line.m * posTo + line.b);
+        double highError = abs(areas[posFrom] - line.m * posFrom + line.b);
 
         deleted = false;
 
         if(lowError > maxError)
         {
-            to++;
             posTo++;
             deleted = true;
         }
 
         if(highError > maxError)
         {
-            if(to != from)
+            if(posTo != posFrom)
             {
-                from--;
                 posFrom--;
                 deleted = true;
             }
         }
     }
 
+    *first = posTo;
+    *last = posFrom;
+}
+
+// LMS outlier rejection for a cluster: sorts the view by MBR area and
+// drops the components whose area is an outlier (see areaInlierRange)
+// from both ends. Views of one component are left as they are.
+ClusterStep areaInliers(double maxError)
+{
+    // Nonsensical error
+    if(maxError < 0)
+    {
+      pipelineLog() << "areaInliers: maxError " << maxError << " is < 0!\n";
+      assert(maxError < 0);
+    }
+
+    return [maxError](const ComponentStore& store, vector<int>* cluster)
+    {
+        // no ratio filtering needed
+        if(cluster->size() == 0 || cluster->size() == 1)
+            return;
 
-    // get subvector excluding those components
-    // that were marked for deletion
-    *cluster = vector<ConnectedComponent>(to, from + 1);
+        // sort list by MBR area sizes
+        sort(cluster->begin(), cluster->end(), sortByMBRArea(store));
 
+        vector<int> areas;
+        for(auto id = cluster->begin(); id != cluster->end(); id++)
+            areas.push_back(store.area[*id]);
 
+        int first, last;
+        areaInlierRange(areas, maxError, &first, &last);
 
-    // old local difference algo; (maybe) obsolete:
+        // drop the components that were marked
+        // for deletion, without a new vector
+        cluster->erase(cluster->begin() + last + 1, cluster->end());
+        cluster->erase(cluster->begin(), cluster->begin() + first);
 
-    // while the max_area / min_area is > ratio,
-    // mark elements for deletion
-    /*auto to = cluster->begin();
-    auto from = cluster->end() - 1;
 
-    // Drop components from the cluster until the ratio is obeyed.
-    // Always drop either the minimum or maximum element, depending
-    // on which has the larger difference to its neighbor.
-    while((cluster->at(from - cluster->begin()).area) / (cluster->at(to - cluster->begin()).area) > ratio &&
-           to != from)
-    {
-        // find out which outlier has a greater local difference
-        // and mark it for deletion
-        int lowDiff = localAreaDiff(*cluster, (to - cluster->begin()), false); //(*(to + 1)).area - (*to).area;
-        int highDiff = localAreaDiff(*cluster, (from - cluster->begin()), true); //(*from).area - (*(from - 1)).area;
+        // old local difference algo; (maybe) obsolete:
 
-        if(lowDiff > highDiff)
-            to++;
+        // while the max_area / min_area is > ratio,
+        // mark elements for deletion
+        /*auto to = cluster->begin();
+        auto from = cluster->end() - 1;
 
-        else
-            from--;
-    }
+        // Drop components from the cluster until the ratio is obeyed.
+        // Always drop either the minimum or maximum element, depending
+        // on which has the larger difference to its neighbor.
+        while((cluster->at(from - cluster->begin()).area) / (cluster->at(to - cluster->begin()).area) > ratio &&
+               to != from)
+        {
+            // find out which outlier has a greater local difference
+            // and mark it for deletion
+            int lowDiff = localAreaDiff(*cluster, (to - cluster->begin()), false); //(*(to + 1)).area - (*to).area;
+            int highDiff = localAreaDiff(*cluster, (from - cluster->begin()), true); //(*from).area - (*(from - 1)).area;
+
+            if(lowDiff > highDiff)
+                to++;
+
+            else
+                from--;
+        }
 
-    // get subvector excluding those components
-    // that were marked for deletion
-    *cluster = vector<ConnectedComponent>(to, from + 1);
-    */
+        // get subvector excluding those components
+        // that were marked for deletion
+        *cluster = vector<ConnectedComponent>(to, from + 1);
+        */
 
-    //cout << "NOW: " << cluster->size() << " / " << before << "\n";
+        //cout << "NOW: " << cluster->size() << " / " << before << "\n";
+    };
 }
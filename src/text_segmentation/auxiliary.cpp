@@ -8,8 +8,14 @@
 #include "include/text_segmentation/auxiliary.hpp"
 #include "include/text_segmentation/colorconversions.hpp"
 #include "include/text_segmentation/connectedcomponent.hpp"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
+#include "include/thresholdkernel.hpp"
+#include "include/stripreader.hpp"
 
 #include <stack>
+#include <set>
 #include <list>
 #include <algorithm>
 #include <iostream>
@@ -144,66 +150,56 @@ vector<Vec2i> pointToVec (vector<Point> pl)
 // Expects a binary (CV_U8 / CV_U8C1) matrix.
 vector<Vec2i> getBlackComponentPixels (Vec2i pixel, Mat* image)
 {   
-    stack<Vec2i>* active = new stack<Vec2i>; // stack for new, unexpanded nodes
-    vector<Vec2i>* found = new vector<Vec2i>; // list for expanded nodes
-    vector<Vec2i>* connected = new vector<Vec2i>; // output list
+    stack<Vec2i> active; // stack for new, unexpanded nodes
+    set<long long> found; // expanded nodes (row * cols + col)
+    vector<Vec2i> connected; // output list
     vector<Vec2i> currentBlackNeighbors; // contains all black neighbors of current
     Vec2i current; // pixel that is currently being evaluated
 
     if(image->type() != 0)
     {
-        cout << "blackNeighbors: Matrix had " << image->channels() << " channels instead of 1!" << "\n";
-        return *connected;
+        pipelineLog() << "blackNeighbors: Matrix had " << image->channels() << " channels instead of 1!" << "\n";
+        return connected;
     }
 
     // if starting point is not black
     // return empty list
     if(image->at<uchar>(pixel[0], pixel[1]) != 0)
-        return *connected;
+        return connected;
 
     else
     {
         // add start pixel to open set and output
-        // found->push_back(pixel);
-        active->push(pixel);
+        // found.push_back(pixel);
+        active.push(pixel);
 
         // search neighbors while
         // there are still unexpanded pixels
-        while (!active->empty())
+        while (!active.empty())
         {
             // Set the current pixel to the top pixel in the
             // stack and pop that pixel from the stack.
-            current = active->top();
-            active->pop();
+            current = active.top();
+            active.pop();
 
             // if active pixel hasn't been found yet
-            if(find(found->begin(), found->end(), current) == found->end())
+            if(found.insert((long long) current[0] * image->cols + current[1]).second)
             {
-                // mark current as found
-                found->push_back(current);
-
                 // add current to output list
-                connected->push_back(current);
+                connected.push_back(current);
 
                 // retrieve all neighbors for the current pixel
                 currentBlackNeighbors = eightConnectedBlackNeighbors(current, image);
 
                 // add all black neighbors to the active stack
                 for(auto neighbor = currentBlackNeighbors.begin(); neighbor != currentBlackNeighbors.end(); neighbor++)
-                    if(find(found->begin(), found->end(), *neighbor) == found->end())
-                        active->push(*neighbor);
+                    if(found.count((long long) (*neighbor)[0] * image->cols + (*neighbor)[1]) == 0)
+                        active.push(*neighbor);
             }
         }
 
 
-        vector<Vec2i> ret = *connected;
-
-        // cleanup
-        //delete connected;
-        //delete active;
-        //delete found;
-
-        return ret;
+        return connected;
     }
 }
 
@@ -216,6 +212,32 @@ void eraseComponentPixels (ConnectedComponent comp, Mat* image)
     eraseConnectedPixels(seed, image);
 }
 
+// Erase the pixels of a component given by its runs, without
+// searching for them. Falls back to the seed if it has no runs.
+void eraseComponentRuns (const ConnectedComponent& comp, const vector<PixelRun>& runs, Mat* image)
+{
+    if(comp.numRuns == 0)
+    {
+        eraseConnectedPixels(comp.seed, image);
+        return;
+    }
+
+    for(int r = comp.firstRun; r < comp.firstRun + comp.numRuns; r++)
+    {
+        uchar* row = image->ptr<uchar>(runs[r].row);
+        fill(row + runs[r].colStart, row + runs[r].colEnd + 1, (uchar) 255);
+    }
+}
+
+// Erase the pixels of a component with the label image of the labeling
+// it was found in: one compare-and-set sweep over its MBR.
+void eraseComponentLabel (const ConnectedComponent& comp, const Mat& labels, Mat* image)
+{
+    Rect mbr = Rect(Point(comp.mbr_min[1], comp.mbr_min[0]), Point(comp.mbr_max[1] + 1, comp.mbr_max[0] + 1));
+
+    eraseLabel(labels, comp.label, mbr, image);
+}
+
 // Erase all black pixels connected to the input pixel.
 void eraseConnectedPixels(Vec2i seed, Mat* image)
 {
@@ -223,9 +245,9 @@ void eraseConnectedPixels(Vec2i seed, Mat* image)
     if(seed[0] < 0 || seed[0] > image->rows ||
             seed[1] < 0 || seed[1] > image->cols)
     {
-        cout << "eraseComponentPixels: Seed of bounds!\n";
-        cout << "Image was " << image->rows << ", " << image->cols << " (rows, cols)\n";
-        cout << "Seed was " << seed[0] << ", " << seed[1] << "\n";
+        pipelineLog() << "eraseComponentPixels: Seed of bounds!\n";
+        pipelineLog() << "Image was " << image->rows << ", " << image->cols << " (rows, cols)\n";
+        pipelineLog() << "Seed was " << seed[0] << ", " << seed[1] << "\n";
 
         return;
     }
@@ -245,30 +267,117 @@ void eraseConnectedPixels(Vec2i seed, Mat* image)
  * @param input The input image in matrix form.
  * @param output The black layer in matrix form.
  */
-void getBlackLayer(Vec3b thresholds, Mat input, Mat* output)
+void getBlackLayer(Vec3b thresholds, const Mat& input, Mat* output)
 {
-    for(int i = 0; i < input.rows; i++)
-        for(int j = 0; j < input.cols; j++)
-        {
-            Vec3b currentPixel = input.at<Vec3b>(i, j);
+    ScopedStageTimer timer("getBlackLayer");
 
-            // check thresholds (Vec3b is BGR!)
-            if(currentPixel[0] <= thresholds[0] &&
-                    currentPixel[1] <= thresholds[1] &&
-                    currentPixel[2] <= thresholds[2])
-            {
-                // pixel below all thresholds: make it black
-                output->at<uchar>(i, j) = 0;
-            }
+    // pixels below all thresholds become black, all others white (Vec3b is BGR!)
+    long long blackPixels = thresholdBGR(input, thresholds, 0, 255, output);
 
-            // else: make pixel white
-            else
-                output->at<uchar>(i, j) = 255;
-        }
+    countStage("getBlackLayer", "pixels", (long long) input.rows * input.cols);
+    countStage("getBlackLayer", "blackPixels", blackPixels);
+
+    debugShow("black layer", *output);
+    debugWrite("BLACK.png", *output);
+}
+
+/**
+ * @brief Extract a black layer with a threshold chosen from
+ * the image itself. The largest channel value of each pixel
+ * and its histogram are computed in one pass over the color
+ * image; Otsu's method then picks the threshold that separates
+ * ink from paper best, and the max. channel image is binarized
+ * in place. Same result as getBlackLayer with (t, t, t).
+ * @param input The input image in matrix form.
+ * @param output The black layer in matrix form.
+ * @return The chosen thresholds (t, t, t).
+ */
+Vec3b getAutoBlackLayer(const Mat& input, Mat* output)
+{
+    ScopedStageTimer timer("getBlackLayer");
+
+    long long histogram[256] = { 0 };
+    channelMaximum(input, output, histogram);
+
+    int threshold = otsuThreshold(histogram);
+    long long blackPixels = thresholdGray(*output, threshold, 0, 255, output);
+
+    countStage("getBlackLayer", "pixels", (long long) input.rows * input.cols);
+    countStage("getBlackLayer", "blackPixels", blackPixels);
+    countStage("getBlackLayer", "threshold", threshold);
+
+    debugShow("black layer", *output);
+    debugWrite("BLACK.png", *output);
+
+    return Vec3b(threshold, threshold, threshold);
+}
+
+// Builds the black layer while the image is decoded, one strip of
+// rows at a time, so the color image is never fully in memory.
+// If automatic is set, the thresholds are ignored: the strips only
+// yield the max. channel image and its histogram, and the threshold
+// chosen by Otsu's method is applied afterwards (stored in chosen
+// if it isn't NULL).
+// Returns false if the file format can't be read in strips
+// (the image has to be loaded with imread then).
+bool streamBlackLayer(const string& filename, Vec3b thresholds, Mat* output, int stripRows, bool automatic, Vec3b* chosen)
+{
+    StripReader reader;
+
+    if(!reader.open(filename))
+        return false;
+
+    ScopedStageTimer timer("streamBlackLayer");
+
+    output->create(reader.rows(), reader.cols(), CV_8U);
+
+    Mat strip;
+    int firstRow, n;
+    int rowsDone = 0;
+    long long blackPixels = 0;
+    long long histogram[256] = { 0 };
+
+    while((n = reader.read(stripRows, &strip, &firstRow)) > 0)
+    {
+        Mat outputRows = output->rowRange(firstRow, firstRow + n);
+
+        if(automatic)
+            channelMaximum(strip, &outputRows, histogram);
+        else
+            blackPixels += thresholdBGR(strip, thresholds, 0, 255, &outputRows);
+
+        rowsDone += n;
+        countStage("streamBlackLayer", "strips", 1);
+    }
+
+    // truncated file
+    if(rowsDone != reader.rows())
+    {
+        pipelineLog() << "streamBlackLayer: " << filename << " ended after " << rowsDone << " of " << reader.rows() << " rows\n";
+        output->release();
+
+        return false;
+    }
+
+    if(automatic)
+    {
+        int threshold = otsuThreshold(histogram);
+        blackPixels = thresholdGray(*output, threshold, 0, 255, output);
+        thresholds = Vec3b(threshold, threshold, threshold);
+
+        countStage("streamBlackLayer", "threshold", threshold);
+    }
+
+    if(chosen != NULL)
+        *chosen = thresholds;
+
+    countStage("streamBlackLayer", "pixels", (long long) output->rows * output->cols);
+    countStage("streamBlackLayer", "blackPixels", blackPixels);
+
+    debugShow("black layer", *output);
+    debugWrite("BLACK.png", *output);
 
-    namedWindow("black layer", CV_WINDOW_NORMAL);
-    imshow("black layer", *output);
-    imwrite("BLACK.png", *output );
+    return true;
 }
 
 
@@ -0,0 +1,311 @@
+/**
+  * First pass of the connected-component labeling, done on 2x2 pixel
+  * blocks instead of single pixels (as in the BBDT algorithm of Grana
+  * et al., "Optimized Block-Based Connected Components Labeling With
+  * Decision Trees"): all foreground pixels of a block are 8-connected,
+  * so only one label per block is needed, and a small decision tree
+  * decides which neighboring blocks are connected to it.
+  *
+  * Author: phugen
+  */
+
+#include "include/text_segmentation/blocklabeling.hpp"
+#include "include/opencvincludes.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+using namespace cv;
+
+
+// number of strips set by setLabelingStrips (0 = automatic)
+static atomic<int> fixedStrips(0);
+
+
+// Unpacks row i of the image into bytes (0 or 1); pixel j goes
+// to buffer[j + 1], so buffer[0] and the bytes right of the last
+// column are the (empty) border.
+static void unpackRow (const BinaryImage& image, int i, vector<uchar>* buffer)
+{
+    fill(buffer->begin(), buffer->end(), 0);
+
+    const uint64_t* words = image.row(i);
+
+    for(int w = 0; w < image.words(); w++)
+        for(uint64_t word = words[w]; word != 0; word &= word - 1)
+            (*buffer)[w * 64 + lowestBit(word) + 1] = 1;
+}
+
+// Labels the 2x2 blocks in block rows firstRow .. lastRow-1 in raster
+// order; the block row above firstRow is treated as empty. The labels
+// are numbered from 1 in each strip, and each new label gets a set in
+// uf (which has to contain only set 0, the background). Labels of
+// connected blocks are merged there.
+//
+// For block X, the decision tree looks at these pixels (rows 2r-1 .. 2r+1,
+// columns 2c-1 .. 2c+2) of X and of its neighbor blocks P, Q, R and S:
+//
+//    P.d  Q.c  Q.d  R.c
+//    S.b   a    b
+//    S.d   c    d
+//
+// Neighbors that are connected to each other through pixels seen here
+// were merged when the later of them was labeled, so they are skipped.
+static void labelStrip (const BinaryImage& image, BlockLabels* blocks, int firstRow, int lastRow, UnionFind* uf)
+{
+    const int cols = image.cols();
+    const vector<int> emptyRow(blocks->stride, 0);
+
+    // rows 2r-1, 2r and 2r+1 of the current block row, with one
+    // empty pixel left and two right of the image
+    vector<uchar> up(cols + 3, 0), top(cols + 3, 0), bottom(cols + 3, 0);
+
+    for(int r = firstRow; r < lastRow; r++)
+    {
+        const uint64_t* topWords = image.row(2 * r);
+        const uint64_t* bottomWords = image.row(2 * r + 1); // row "rows" is the empty padding row
+
+        swap(up, bottom);
+        unpackRow(image, 2 * r, &top);
+        unpackRow(image, 2 * r + 1, &bottom);
+
+        int* current = &blocks->labels[(r + 1) * blocks->stride + 1];
+        const int* above = r == firstRow ? &emptyRow[1] : current - blocks->stride;
+
+        for(int w = 0; w < image.words(); w++)
+        {
+            // 32 blocks without any foreground pixel
+            if((topWords[w] | bottomWords[w]) == 0)
+                continue;
+
+            int last = min(32 * w + 32, blocks->blockCols);
+
+            for(int c = 32 * w; c < last; c++)
+            {
+                const int x = 2 * c + 1; // buffer index of pixel column 2c
+
+                const bool a = top[x], b = top[x + 1], cc = bottom[x], d = bottom[x + 1];
+
+                if(!(a | b | cc | d))
+                    continue;
+
+                const bool Pd = up[x - 1], Qc = up[x], Qd = up[x + 1], Rc = up[x + 2];
+                const bool Sb = top[x - 1], Sd = bottom[x - 1];
+
+                const bool toQ = (a | b) & (Qc | Qd);
+                const bool toS = (a | cc) & (Sb | Sd);
+                const bool toP = a & Pd;
+                const bool toR = b & Rc;
+
+                int label;
+
+                if(toQ)
+                {
+                    label = above[c];
+
+                    if(toR && !Qd)
+                        uf->merge(label, above[c + 1]);
+                    if(toS && !(Sb && Qc))
+                        uf->merge(label, current[c - 1]);
+                    if(toP && !Qc && !(toS && Sb))
+                        uf->merge(label, above[c - 1]);
+                }
+
+                else if(toS)
+                {
+                    label = current[c - 1];
+
+                    if(toR)
+                        uf->merge(label, above[c + 1]);
+                    if(toP && !Sb)
+                        uf->merge(label, above[c - 1]);
+                }
+
+                else if(toP)
+                {
+                    label = above[c - 1];
+
+                    if(toR)
+                        uf->merge(label, above[c + 1]);
+                }
+
+                else if(toR)
+                    label = above[c + 1];
+
+                // not connected to any labeled block: new label
+                else
+                    label = uf->add();
+
+                current[c] = label;
+            }
+        }
+    }
+}
+
+// Labels strips of block rows at the same time, each into its own union-find.
+class StripLabelingBody : public ParallelLoopBody
+{
+public:
+    StripLabelingBody(const BinaryImage& image, BlockLabels* blocks, vector<UnionFind>* stripSets)
+        : image(image), blocks(blocks), stripSets(stripSets)
+    {}
+
+    void operator() (const Range& strips) const
+    {
+        for(int s = strips.start; s < strips.end; s++)
+            labelStrip(image, blocks, blocks->stripStart[s], blocks->stripStart[s + 1], &(*stripSets)[s]);
+    }
+
+private:
+    const BinaryImage& image;
+    BlockLabels* blocks;
+    vector<UnionFind>* stripSets;
+};
+
+// Moves the labels of each strip into its range of the global labels
+// and adds the equivalences found in the strip to the global sets.
+class StripOffsetBody : public ParallelLoopBody
+{
+public:
+    StripOffsetBody(BlockLabels* blocks, vector<UnionFind>* stripSets, ConcurrentUnionFind* uf)
+        : blocks(blocks), stripSets(stripSets), uf(uf)
+    {}
+
+    void operator() (const Range& strips) const
+    {
+        for(int s = strips.start; s < strips.end; s++)
+        {
+            const int offset = blocks->firstLabel[s];
+            UnionFind& local = (*stripSets)[s];
+
+            for(int l = 1; l < local.size(); l++)
+            {
+                int root = local.find(l);
+
+                if(root != l)
+                    uf->merge(offset + root, offset + l);
+            }
+
+            if(offset == 0)
+                continue;
+
+            int* label = &blocks->labels[(blocks->stripStart[s] + 1) * blocks->stride];
+            int* end = &blocks->labels[(blocks->stripStart[s + 1] + 1) * blocks->stride];
+
+            for(; label != end; label++)
+                if(*label != 0)
+                    *label += offset;
+        }
+    }
+
+private:
+    BlockLabels* blocks;
+    vector<UnionFind>* stripSets;
+    ConcurrentUnionFind* uf;
+};
+
+// Merges the blocks of block row r (the first row of a strip) with the
+// connected blocks in the row above, which belongs to the previous strip.
+static void mergeStripBorder (const BinaryImage& image, const BlockLabels& blocks, int r, ConcurrentUnionFind* uf)
+{
+    const int cols = image.cols();
+    vector<uchar> up(cols + 3, 0), top(cols + 3, 0), bottom(cols + 3, 0);
+
+    unpackRow(image, 2 * r - 1, &up);
+    unpackRow(image, 2 * r, &top);
+    unpackRow(image, 2 * r + 1, &bottom);
+
+    const int* current = &blocks.labels[(r + 1) * blocks.stride + 1];
+    const int* above = current - blocks.stride;
+
+    for(int c = 0; c < blocks.blockCols; c++)
+    {
+        if(current[c] == 0)
+            continue;
+
+        const int x = 2 * c + 1;
+        const bool a = top[x], b = top[x + 1];
+
+        if((a | b) & (up[x] | up[x + 1]))
+            uf->merge(current[c], above[c]);
+        if(a & up[x - 1])
+            uf->merge(current[c], above[c - 1]);
+        if(b & up[x + 2])
+            uf->merge(current[c], above[c + 1]);
+    }
+}
+
+// Merges the first block row of each strip (but the first) with the row above.
+class StripBorderBody : public ParallelLoopBody
+{
+public:
+    StripBorderBody(const BinaryImage& image, const BlockLabels& blocks, ConcurrentUnionFind* uf)
+        : image(image), blocks(blocks), uf(uf)
+    {}
+
+    void operator() (const Range& strips) const
+    {
+        for(int s = max(strips.start, 1); s < strips.end; s++)
+            mergeStripBorder(image, blocks, blocks.stripStart[s], uf);
+    }
+
+private:
+    const BinaryImage& image;
+    const BlockLabels& blocks;
+    ConcurrentUnionFind* uf;
+};
+
+// Labels the 2x2 blocks of the image. Large images are split into
+// horizontal strips that are labeled in parallel, each with its own
+// label range; the equivalences of all strips and those across the
+// strip borders are then merged into uf (also in parallel), which
+// gets one set per label and set 0 for the background.
+//
+// The labels differ with the number of strips, but the partition of
+// the blocks into connected sets doesn't.
+void labelBlocks (const BinaryImage& image, BlockLabels* blocks, ConcurrentUnionFind* uf)
+{
+    const int rows = image.rows();
+    const int cols = image.cols();
+
+    blocks->blockRows = (rows + 1) / 2;
+    blocks->blockCols = (cols + 1) / 2;
+    blocks->stride = blocks->blockCols + 2;
+    blocks->labels.assign((blocks->blockRows + 1) * blocks->stride, 0);
+
+    // one strip per thread, but not shorter than LABELING_STRIP_ROWS
+    int strips = max(1, min(getNumThreads(), rows / LABELING_STRIP_ROWS));
+
+    if(fixedStrips > 0)
+        strips = max(1, min(fixedStrips.load(), blocks->blockRows));
+
+    blocks->stripStart.resize(strips + 1);
+
+    for(int s = 0; s <= strips; s++)
+        blocks->stripStart[s] = (int) ((long long) blocks->blockRows * s / strips);
+
+    vector<UnionFind> stripSets(strips, UnionFind(1));
+    parallel_for_(Range(0, strips), StripLabelingBody(image, blocks, &stripSets), strips);
+
+    blocks->firstLabel.resize(strips + 1);
+    blocks->firstLabel[0] = 0;
+
+    for(int s = 0; s < strips; s++)
+        blocks->firstLabel[s + 1] = blocks->firstLabel[s] + stripSets[s].size() - 1;
+
+    blocks->count = blocks->firstLabel[strips];
+
+    // equivalences found inside the strips ...
+    uf->reset(blocks->count + 1);
+    parallel_for_(Range(0, strips), StripOffsetBody(blocks, &stripSets, uf), strips);
+
+    // ... and across the strip borders (once all labels are global)
+    if(strips > 1)
+        parallel_for_(Range(0, strips), StripBorderBody(image, *blocks, uf), strips);
+}
+
+void setLabelingStrips (int strips)
+{
+    fixedStrips = strips;
+}
@@ -13,13 +13,18 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <algorithm>
 
 #include "include/text_segmentation/auxiliary.hpp"
 #include "include/text_segmentation/colorconversions.hpp"
 #include "include/text_segmentation/customhoughtransform.hpp"
 #include "include/text_segmentation/areafilter.hpp"
 #include "include/text_segmentation/collinearstring.hpp"
+#include "include/text_segmentation/componentstore.hpp"
 #include "include/text_segmentation/statistics.hpp"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
 
 using namespace std;
 using namespace cv;
@@ -27,21 +32,22 @@ using namespace cv;
 
 //#define DEBUG_LINE
 //#define DEBUG_MBR
-//#define DEBUG_DELETION
 
 
-// Compare two components referencing the hough
-// line they were grouped with.
+// Compare two components (ids in store) referencing
+// the hough line they were grouped with.
 struct compareByLineDistance
 {
     Vec3f polarLine;
+    const ComponentStore* store;
 
-    compareByLineDistance(Vec3f line)
+    compareByLineDistance(Vec3f line, const ComponentStore* store)
     {
         this->polarLine = line;
+        this->store = store;
     }
 
-    bool operator () (ConnectedComponent a, ConnectedComponent b)
+    bool operator () (int a, int b)
     {
         // calculate perpendicular line that
         // intersects a and b respectively
@@ -60,11 +66,11 @@ struct compareByLineDistance
         double lp2_y = m * lp2_x + y_isec;
 
         // Calculate intersection points for a and b:
-        double a_x = a.centroid[1];
-        double a_y = a.centroid[0];
+        double a_x = store->centroidCol[a];
+        double a_y = store->centroidRow[a];
 
-        double b_x = b.centroid[1];
-        double b_y = b.centroid[0];
+        double b_x = store->centroidCol[b];
+        double b_y = store->centroidRow[b];
 
         double k_a = ((lp2_y - lp1_y) * (a_x - lp1_x) - (lp2_x - lp1_x) * (a_y - lp1_y)) / (pow((lp2_y - lp1_y), 2) + pow((lp2_x - lp1_x), 2));
         Vec2f a_i = Vec2f(a_y + k_a * (lp2_x - lp1_x), a_x - k_a * (lp2_y - lp1_y));
@@ -79,53 +85,93 @@ struct compareByLineDistance
 };
 
 
-// Performs collinear grouping and deletion of potential characters
-// via Hough transformation on the MBR centroids of all components.
-void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comps)
+// Order components (ids in store) by the top left corner of
+// their MBR (row first), so erasing them walks down the image.
+static bool mbrRasterBefore (const ComponentStore& store, int a, int b)
+{
+    if(store.minRow[a] != store.minRow[b])
+        return store.minRow[a] < store.minRow[b];
+
+    return store.minCol[a] < store.minCol[b];
+}
+
+// Adds the component to the cluster unless a component with
+// the same MBR is in there already (returns false then).
+static bool addToCluster (const ComponentStore& store, int id, vector<int>* cluster)
+{
+    for(auto other = cluster->begin(); other != cluster->end(); other++)
+        if(store.sameMBR(*other, id))
+            return false;
+
+    cluster->push_back(id);
+    return true;
+}
+
+// Performs collinear grouping via Hough transformation on the MBR
+// centroids of all components and returns the ids (indices in comps)
+// of the components that were found to be characters, ordered by
+// the top left corner of their MBR.
+//
+// Only the geometry of the components and the size of the image are
+// used, so the grouping of a whole sheet can be done without a copy
+// of its pixels (see tiledTextRemoval). The caller times the stage.
+void findTextComponents (const Mat& input, const vector<ConnectedComponent>& comps, vector<int>* text)
 {
+    text->clear();
+
     // No components passed the filters - no work left to do.
-    if(comps->size() == 0)
+    if(comps.size() == 0)
         return;
 
+    countStage("collinearGrouping", "components", comps.size());
+
     int rows = input.rows;
     int cols = input.cols;
     double avgheight = 0;
 
-    // create new matrix for performing
-    // Hough transform on centroids only
-    Mat hough_UC = Mat(rows, cols, CV_8U);
+    // The grouping works on the columns of the components and refers
+    // to them by id, which is their index in comps.
+    ComponentStore store = ComponentStore(comps);
+    const int numComps = store.size();
 
-    // set entire matrix to background color (= black, because hough expects edges to be white)
-    for(int i = 0; i < rows; i++)
-        for(int j = 0; j < cols; j++)
-            hough_UC.at<uchar>(i, j) = 0;
+    // The Hough transform is done on the centroids of the
+    // connected components only, voting from the point list
+    vector<Vec2i> centroids;
+    centroids.reserve(numComps);
 
-    // extract centroids of connected components
-    for (vector<ConnectedComponent>::iterator iter = comps->begin(); iter != comps->end(); iter++)
+    for(int id = 0; id < numComps; id++)
     {
-        ConnectedComponent curr = *iter;
-
-        hough_UC.at<uchar>(curr.centroid[0], curr.centroid[1]) = 255; // mark centroid as white in Hough matrix
-        avgheight += curr.mbr_max[0] - curr.mbr_min[0]; // cumulative height of all components
+        centroids.push_back(store.centroid(id));
+        avgheight += store.maxRow[id] - store.minRow[id]; // cumulative height of all components
     }
 
-    namedWindow("CENTROIDS", CV_WINDOW_NORMAL);
-    imshow("CENTROIDS", hough_UC);
+    // the centroids as an image are only needed for showing them
+    Mat hough_UC;
+
+    if(debugViewEnabled())
+    {
+        hough_UC = Mat::zeros(rows, cols, CV_8U);
 
-    // output matrix for showing found lines
-    Mat showHough;
-    cvtColor(input, showHough, CV_GRAY2RGB);
+        for(auto c = centroids.begin(); c != centroids.end(); c++)
+            hough_UC.at<uchar>((*c)[0], (*c)[1]) = 255;
+
+        debugShow("CENTROIDS", hough_UC);
+    }
 
     // matrix that indicates which components are
-    // part of the current cluster
-    Mat clusterMat_V3;
-    cvtColor(input, clusterMat_V3, CV_GRAY2RGB);
+    // part of the current cluster (a full-size color
+    // image, so only create it when it's drawn on)
+    #if defined(DEBUG_LINE) || defined(DEBUG_MBR)
+        Mat clusterMat_V3;
+        cvtColor(input, clusterMat_V3, CV_GRAY2RGB);
+    #endif
 
-    // output matrix
-    Mat erased = input.clone();
+    // The strings are walked again on every threshold level,
+    // so isText makes sure each character is reported only once.
+    vector<bool> isText(numComps, false);
 
     // calculate average height of all components
-    avgheight /= comps->size();
+    avgheight /= comps.size();
 
     float guess_factor = 0.2 * avgheight; // Initial guess for the rho resolution: average height of components
     guess_factor > 0 ? guess_factor = guess_factor : guess_factor = 1;
@@ -137,32 +183,33 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
     int numRho = cvRound(((cols + rows) * 2 + 1) / rho); // number of rho steps
     int counter = 0; // when this becomes 2, the algorithm stops.
 
-    int* accumulator = new int[(numAngle+2) * (numRho+2)]; // accumulator matrix to pass to HoughLinesCustom to retain accum information
+    int* accumulator = new int[(numAngle+2) * (numRho+2)]; // accumulator matrix to pass to HoughLinesPoints to retain accum information
     memset(accumulator, 0, (sizeof(int) * (numAngle+2) * (numRho+2))); // initialize accumulator with zero values
 
     vector<Vec3f> lines; // will contain all found lines
-    map<Vec2i, vector<int>, Vec2iCompare> contributions; // stores accumulator contribution positions for all input points
+    HoughContributions contributions; // which input points voted in which Hough pass
 
     // Do multiple hough transforms using the same accumulator while limiting
     // the angle of the lines to 0° - 5°, 85° - 95° and 175° - 180° respectively
     // to find all vertically or horizontally aligned components
-    HoughLinesCustom(hough_UC, rho, theta, 0.0, 0.0872665, accumulator, &contributions);
-    HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 0.0, threshold, &lines, THRESH_GT);
+    {
+        ScopedStageTimer houghTimer("collinearGrouping/hough");
 
-    HoughLinesCustom(hough_UC, rho, theta, 1.48353, 1.65806, accumulator, &contributions);
-    HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 1.48353, threshold, &lines, THRESH_GT);
+        HoughLinesPoints(centroids, input.size(), rho, theta, 0.0, 0.0872665, accumulator, &contributions);
+        HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 0.0, threshold, &lines, THRESH_GT);
 
-    HoughLinesCustom(hough_UC, rho, theta, 3.05433, 3.14159, accumulator, &contributions);
-    HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 3.05433, threshold, &lines, THRESH_GT);
+        HoughLinesPoints(centroids, input.size(), rho, theta, 1.48353, 1.65806, accumulator, &contributions);
+        HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 1.48353, threshold, &lines, THRESH_GT);
 
+        HoughLinesPoints(centroids, input.size(), rho, theta, 3.05433, 3.14159, accumulator, &contributions);
+        HoughLinesExtract(accumulator, numRho, numAngle, rho, theta, 3.05433, threshold, &lines, THRESH_GT);
+    }
 
-    cout << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
 
-    // debug window
-    namedWindow("WITHOUT TEXT", CV_WINDOW_NORMAL);
+    pipelineLog() << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
 
     vector<Vec3f> clustered_cells; // accumulator cell positions of cells in the cluster
-    vector<ConnectedComponent> cluster; // components that lie on clusterLines
+    vector<int> cluster; // ids of the components that lie on clusterLines
     vector<CollinearString> collinearStrings; // contains meta information gained from clusters
 
     avgheight = 0.; // Reset average height
@@ -173,6 +220,11 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
     {
         while (threshold > 2)
         {
+            // time and count each threshold level separately
+            string level = "collinearGrouping/pass" + to_string(counter) + "/threshold" + to_string(threshold);
+            ScopedStageTimer levelTimer(level);
+            countStage(level, "houghLines", lines.size());
+
             // PAPER STEPS 4-10: for all INITIAL LINES
             for (auto houghLine = lines.begin(); houghLine != lines.end(); houghLine++)
             {
@@ -189,19 +241,17 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 // Simultaneously, calculate the average MBR height
                 // of all components in the cluster in order to refine
                 // the rho resolution guess.
-                for(auto component = comps->begin(); component != comps->end(); component++)
+                for(int id = 0; id < numComps; id++)
                 {
                     // If point lies between initial cluster lines, it's in the cluster
-                    if(pointBetweenPolarLines((*component).centroid, clustered_cells.at(0), clustered_cells.at(1)))
+                    if(pointBetweenPolarLines(store.centroid(id), clustered_cells.at(0), clustered_cells.at(1)))
                     {
                         // Add component to cluster if it wasn't in there already
-                        if(find(cluster.begin(), cluster.end(), *component) == cluster.end())
-                            cluster.push_back(*component);
-                        else
+                        if(!addToCluster(store, id, &cluster))
                             break;
 
                         // calculate average height of the cluster iteratively
-                        avgheight += (*component).mbr_max[0] - (*component).mbr_min[0];
+                        avgheight += store.maxRow[id] - store.minRow[id];
                     }
                 }
 
@@ -216,31 +266,27 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 clusterCells(factor, rho, numRho, *houghLine, &clustered_cells);
 
                 // Find all components whose accumulator cells belong to the cluster.
-                for(auto component = comps->begin(); component != comps->end(); component++)
+                for(int id = 0; id < numComps; id++)
                 {
-                    if(pointBetweenPolarLines((*component).centroid, clustered_cells.at(0), clustered_cells.at(1)))
+                    if(pointBetweenPolarLines(store.centroid(id), clustered_cells.at(0), clustered_cells.at(1)))
                     {
                         // Add component to cluster if it wasn't in there already
-                        if(find(cluster.begin(), cluster.end(), *component) == cluster.end())
-                            cluster.push_back(*component);
-                        else
+                        if(!addToCluster(store, id, &cluster))
                             break;
 
                         // calculate average height of the cluster iteratively
-                        avgheight += (*component).mbr_max[0] - (*component).mbr_min[0];
+                        avgheight += store.maxRow[id] - store.minRow[id];
                     }
                 }
 
 
                 // debug: show cluster MBRs---------------------------------------------
                 #ifdef DEBUG_MBR
-                    for(auto comp = cluster.begin(); comp != cluster.end(); comp++)
+                    for(auto id = cluster.begin(); id != cluster.end(); id++)
                     {
-                        ConnectedComponent c = *comp;
-
                         // rectangle works with (col,row), so swap coordinates
-                        Point min = Vec2i(c.mbr_min[1], c.mbr_min[0]);
-                        Point max = Vec2i(c.mbr_max[1], c.mbr_max[0]);
+                        Point min = Vec2i(store.minCol[*id], store.minRow[*id]);
+                        Point max = Vec2i(store.maxCol[*id], store.maxRow[*id]);
 
                         // draw MBR for this component
                         rectangle(clusterMat_V3, min, max, Scalar(255, 0, 0), 1, 8, 0);
@@ -269,28 +315,26 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 if(cluster.size() != 0)
                 {
                     vector<double> areas;
-                    for(auto comp = cluster.begin(); comp != cluster.end(); comp++)
+                    for(auto id = cluster.begin(); id != cluster.end(); id++)
                     {
-                        areas.push_back((*comp).area);
+                        areas.push_back(store.area[*id]);
                     }
 
                     // apply area filter to eliminate extreme components from the cluster
                     // whose centroids are coincidentally on a string's hough line
-                    clusterCompAreaFilter(&cluster, median(areas));
+                    ClusterFilter().add(areaInliers(median(areas)))(store, &cluster);
                 }
 
                 #ifdef DEBUG_MBR
                     // debug: show cluster MBRs FILTERED ---------------------------------------------
-                    for(auto comp = cluster.begin(); comp != cluster.end(); comp++)
+                    for(auto id = cluster.begin(); id != cluster.end(); id++)
                     {
-                        ConnectedComponent c = *comp;
-                        Point min = Vec2i(c.mbr_min[1], c.mbr_min[0]);
-                        Point max = Vec2i(c.mbr_max[1], c.mbr_max[0]);
+                        Point min = Vec2i(store.minCol[*id], store.minRow[*id]);
+                        Point max = Vec2i(store.maxCol[*id], store.maxRow[*id]);
                         rectangle(clusterMat_V3, min, max, Scalar(0, 255, 0), 1, 8, 0);
                     }
 
-                    namedWindow("CURRENT CLUSTER", CV_WINDOW_NORMAL);
-                    imshow("CURRENT CLUSTER", clusterMat_V3);
+                    debugShow("CURRENT CLUSTER", clusterMat_V3);
 
 
                     // reset cluster mat
@@ -299,14 +343,15 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 //------------------------------------------------------------------
 
                 // sort components in this cluster by their distance to the original hough line
-                sort(cluster.begin(), cluster.end(), compareByLineDistance(*houghLine));
+                sort(cluster.begin(), cluster.end(), compareByLineDistance(*houghLine, &store));
 
                 // Calculate component meta information and store it
                 if(cluster.size() != 0)
                 {
-                    CollinearString cs = CollinearString(cluster, avgheight);
+                    CollinearString cs = CollinearString(&store, cluster, avgheight);
                     cs.refine();
                     collinearStrings.push_back(cs);
+                    countStage(level, "strings", 1);
                 }
 
                 // clustering for this hough line is done
@@ -316,6 +361,8 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 clusterNo++;
             }
 
+            int textBefore = text->size();
+
             // All clusters for the current threshold have been evaluated.
             // Now, graphics can be deleted by using the meta information retrieved earlier.
             // Extra care is taken in order to not delete shorter strings before longer strings,
@@ -338,28 +385,27 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
 
                             for(auto coch = current.chars.begin(); coch != current.chars.end(); coch++)
                             {
-                                // erase the pixels associated with the current
-                                // component from the output image
-                                eraseComponentPixels(*coch, &erased);
+                                // mark the current component for erasure
+                                // from the output image
+                                if(!isText[*coch])
+                                {
+                                    isText[*coch] = true;
+                                    text->push_back(*coch);
+                                }
 
                                 // 10.) Delete those values from the accumulator which were contributed
                                 // to it by components which are still in the cluster by now and thus
                                 // are marked for deletion anyway
-                                deleteLineContributions(accumulator, (*coch).centroid, contributions);
+                                deleteLineContributions(accumulator, store.centroid(*coch), &contributions);
                             }
                         }
                     }
 
 
                 }
-
-                #ifdef DEBUG_DELETION
-                    // show intermediate result
-                    imshow("WITHOUT TEXT", erased);
-                    waitKey(0);
-                #endif
             }
 
+            countStage(level, "erasedComponents", text->size() - textBefore);
 
             // decrement accumulator threshold
             threshold--;
@@ -376,7 +422,7 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 HoughLinesExtract (accumulator, numRho, numAngle, rho, theta, 1.48353, threshold, &lines, THRESH_EQ);
                 HoughLinesExtract (accumulator, numRho, numAngle, rho, theta, 3.05433, threshold, &lines, THRESH_EQ);
 
-                cout << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
+                pipelineLog() << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
             }
 
             // if this is the second pass (= 0 - 180° lines, i.e. all other angles)
@@ -386,14 +432,14 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
                 lines.clear();
                 HoughLinesExtract (accumulator, numRho, numAngle, rho, theta, 0., threshold, &lines, THRESH_EQ);
 
-                cout << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
+                pipelineLog() << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
             }
         }
 
         // first pass is done
         if(counter == 0)
         {
-            cout << "\n --------- SECOND PASS. ---------- \n";
+            pipelineLog() << "\n --------- SECOND PASS. ---------- \n";
 
             // show post-first pass (vertical/horizontal) hough lines in blue
             //drawLines(lines, &showHough, Scalar(255, 0, 0));
@@ -406,10 +452,11 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
             lines.clear();
 
             // calculate hough domain for lines with angles [0°, 180°]
-            HoughLinesCustom(hough_UC, rho, theta, 0., 3.14159, accumulator, &contributions);
+            ScopedStageTimer houghTimer("collinearGrouping/hough");
+            HoughLinesPoints(centroids, input.size(), rho, theta, 0., 3.14159, accumulator, &contributions);
             HoughLinesExtract (accumulator, numRho, numAngle, rho, theta, 0., threshold, &lines, THRESH_GT);
 
-            cout << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
+            pipelineLog() << "LINESNOW: " << lines.size() << " with THRESHOLD: " << threshold << "\n";
 
 
             // do one last iteration
@@ -432,23 +479,57 @@ void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comp
     //imshow("HOUGH+IMAGE", showHough);
 
     // show hough lines on component centroids
-    namedWindow("CENTROIDS", CV_WINDOW_NORMAL);
-    imshow("CENTROIDS", hough_UC);
+    if(debugViewEnabled())
+        debugShow("CENTROIDS", hough_UC);
 
     //imwrite("Centroids.png", hough_UC);
 
-    // show result
-    imshow("WITHOUT TEXT", erased);
-
-    //imwrite("without_text.png", erased);
-
-    *output = erased;
-
     // show clustering
     //imshow("CLUSTER", clusters);
 
     // cleanup
     delete [] accumulator;
 
+    // erasing the characters in this order walks down the image
+    sort(text->begin(), text->end(), [&store](int a, int b) { return mbrRasterBefore(store, a, b); });
+}
+
+// Performs collinear grouping and deletion of potential characters
+// via Hough transformation on the MBR centroids of all components.
+// If the label image of the components is given (see unionFindComponents),
+// characters are erased by a sweep over their MBR instead of by a flood fill.
+void collinearGrouping (Mat input, Mat* output, vector<ConnectedComponent>* comps, const Mat* labels)
+{
+    // No components passed the filters - no work left to do.
+    if(comps->size() == 0)
+        return;
+
+    ScopedStageTimer timer("collinearGrouping");
+
+    vector<int> text;
+    findTextComponents(input, *comps, &text);
+
+    // output matrix
+    Mat erased = input.clone();
+
+    {
+        ScopedStageTimer timer("collinearGrouping/erase");
+
+        for(auto id = text.begin(); id != text.end(); id++)
+        {
+            if(labels != NULL)
+                eraseComponentLabel((*comps)[*id], *labels, &erased);
+            else
+                eraseComponentPixels((*comps)[*id], &erased);
+        }
+    }
+
+    // show result
+    debugShow("WITHOUT TEXT", erased);
+
+    //imwrite("without_text.png", erased);
+
+    *output = erased;
+
     //waitKey(0);
 }
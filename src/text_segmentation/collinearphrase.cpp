@@ -13,7 +13,7 @@ CollinearPhrase::~CollinearPhrase()
 
 }
 
-CollinearPhrase::size()
+int CollinearPhrase::size()
 {
     return this->words.size();
 }
@@ -7,14 +7,16 @@
 
 #include "include/text_segmentation/collinearstring.hpp"
 #include "include/text_segmentation/auxiliary.hpp"
+#include "include/pipelinelog.hpp"
 
 using namespace std;
 using namespace cv;
 
 #include <iostream>
 
-CollinearString::CollinearString(vector<ConnectedComponent> cluster, double avgHeight)
+CollinearString::CollinearString(const ComponentStore* store, vector<int> cluster, double avgHeight)
 {
+    this->store = store;
     this->comps = cluster;
     this->groups = vector<CollinearGroup>();
     this->phrases = vector<CollinearPhrase>();
@@ -33,29 +35,33 @@ CollinearString::~CollinearString()
 // Depending on the orientation of the cluster line, either
 // the component's horizontal or vertical MBR lines are used
 // for the calculation.
-double CollinearString::localAvgHeight (vector<ConnectedComponent> cluster, int listPos)
+double CollinearString::localAvgHeight (const vector<int>& cluster, int listPos)
 {
     int startPos, endPos;
     double localAvg = 0;
     int dim;
 
     // determine which MBR dimension to use by inspecting line angle
-    double angle = cluster.at(listPos).houghLine[0];
+    double angle = store->houghLine[cluster.at(listPos)][0];
 
     if(angle <= 0.785398) //|| angle >= 2.53073)
         dim = 1; // line is somewhat vertical (0° - 45°), use X axis for height due to string orientation
     else
         dim = 0; // line is horizonal, use Y-axis for height
 
+    // MBR bounds of the components in that dimension
+    const vector<int>& lo = dim == 1 ? store->minCol : store->minRow;
+    const vector<int>& hi = dim == 1 ? store->maxCol : store->maxRow;
+
     // only one component in the cluster
     if(cluster.size() == 1)
     {
         // component is only 1 pixel wide or long
-        if(cluster.at(0).mbr_max[dim] == cluster.at(0).mbr_min[dim])
+        if(hi[cluster.at(0)] == lo[cluster.at(0)])
             localAvg = 1;
 
         else
-            localAvg = cluster.at(0).mbr_max[dim] - cluster.at(0).mbr_min[dim];
+            localAvg = hi[cluster.at(0)] - lo[cluster.at(0)];
     }
 
     else
@@ -68,11 +74,11 @@ double CollinearString::localAvgHeight (vector<ConnectedComponent> cluster, int
         for(int i = startPos; i <= endPos; i++)
         {
             // component is only 1 pixel wide or long
-            if(cluster.at(i).mbr_max[dim] == cluster.at(i).mbr_min[dim])
+            if(hi[cluster.at(i)] == lo[cluster.at(i)])
                 localAvg += 1;
 
             else
-                localAvg += cluster.at(i).mbr_max[dim] - cluster.at(i).mbr_min[dim];
+                localAvg += hi[cluster.at(i)] - lo[cluster.at(i)];
         }
 
         localAvg /= endPos - startPos;
@@ -84,7 +90,7 @@ double CollinearString::localAvgHeight (vector<ConnectedComponent> cluster, int
 
 // Calculates the distance from the component at listPos
 // to its successor in the list, if possible.
-double CollinearString::edgeToEdgeDistance (vector<ConnectedComponent> cluster, int listPos)
+double CollinearString::edgeToEdgeDistance (const vector<int>& cluster, int listPos)
 {
     // This is the last component in the list.
     // Distance should already have been calculated
@@ -94,8 +100,8 @@ double CollinearString::edgeToEdgeDistance (vector<ConnectedComponent> cluster,
 
 
     // First MBR, coordinates in "matrix style", i.e. top left origin
-    Vec2i mbr_min = cluster.at(listPos).mbr_min;
-    Vec2i mbr_max = cluster.at(listPos).mbr_max;
+    Vec2i mbr_min = store->mbrMin(cluster.at(listPos));
+    Vec2i mbr_max = store->mbrMax(cluster.at(listPos));
 
     Vec2i bot_left_1 = Vec2i(mbr_max[0], mbr_min[1]);
     Vec2i bot_right_1 = mbr_max;
@@ -103,8 +109,8 @@ double CollinearString::edgeToEdgeDistance (vector<ConnectedComponent> cluster,
     Vec2i top_left_1 = mbr_min;
 
     // Second MBR
-    Vec2i mbr_min2 = cluster.at(listPos + 1).mbr_min;
-    Vec2i mbr_max2 = cluster.at(listPos + 1).mbr_max;
+    Vec2i mbr_min2 = store->mbrMin(cluster.at(listPos + 1));
+    Vec2i mbr_max2 = store->mbrMax(cluster.at(listPos + 1));
 
     Vec2i bot_left_2 = Vec2i(mbr_max2[0], mbr_min2[1]);
     Vec2i bot_right_2 = mbr_max2;
@@ -311,7 +317,7 @@ void CollinearString::refine ()
                     if(cp->words.at((int) c).type != 'i')
                     {
                         cp->words.erase(cp->words.begin() + g, cp->words.begin() + (c-1));
-                        cout << "Deleted isolated component sequence at [" << c << " - " << c-1 << "] IN PHRASE " << p << "\n";
+                        pipelineLog() << "Deleted isolated component sequence at [" << c << " - " << c-1 << "] IN PHRASE " << p << "\n";
                     }
                 }
 
@@ -0,0 +1,58 @@
+/**
+  * Column-wise storage of the connected components
+  * that are grouped into collinear strings.
+  *
+  * Author: phugen
+  */
+
+#include "include/text_segmentation/componentstore.hpp"
+
+using namespace std;
+using namespace cv;
+
+ComponentStore::ComponentStore(){}
+
+ComponentStore::ComponentStore(const vector<ConnectedComponent>& comps)
+{
+    for(auto comp = comps.begin(); comp != comps.end(); comp++)
+        add(*comp);
+}
+
+ComponentStore::~ComponentStore(){}
+
+int ComponentStore::size() const
+{
+    return (int) area.size();
+}
+
+int ComponentStore::add(const ConnectedComponent& comp)
+{
+    minRow.push_back(comp.mbr_min[0]);
+    minCol.push_back(comp.mbr_min[1]);
+    maxRow.push_back(comp.mbr_max[0]);
+    maxCol.push_back(comp.mbr_max[1]);
+    centroidRow.push_back(comp.centroid[0]);
+    centroidCol.push_back(comp.centroid[1]);
+    area.push_back(comp.area);
+    numBlackPixels.push_back(comp.numBlackPixels);
+    houghLine.push_back(comp.houghLine);
+
+    return size() - 1;
+}
+
+bool ComponentStore::sameMBR(int a, int b) const
+{
+    return minRow[a] == minRow[b] && minCol[a] == minCol[b] &&
+           maxRow[a] == maxRow[b] && maxCol[a] == maxCol[b];
+}
+
+ConnectedComponent ComponentStore::component(int id) const
+{
+    ConnectedComponent comp = ConnectedComponent(mbrMin(id), mbrMax(id), numBlackPixels[id], Vec2i(-1, -1));
+
+    comp.centroid = centroid(id);
+    comp.area = area[id];
+    comp.houghLine = houghLine[id];
+
+    return comp;
+}
@@ -13,7 +13,11 @@ using namespace std;
 using namespace cv;
 
 ConnectedComponent::ConnectedComponent()
-{}
+{
+    this->label = 0;
+    this->firstRun = 0;
+    this->numRuns = 0;
+}
 
 ConnectedComponent::ConnectedComponent(Vec2i newmin, Vec2i newmax, int newPixels, Vec2i seed)
 {
@@ -28,6 +32,9 @@ ConnectedComponent::ConnectedComponent(Vec2i newmin, Vec2i newmax, int newPixels
 
     this->seed = seed;
     this->numBlackPixels = newPixels;
+    this->label = 0;
+    this->firstRun = 0;
+    this->numRuns = 0;
 }
 
 ConnectedComponent::~ConnectedComponent(){}
@@ -53,7 +53,7 @@
 
 #include "include/text_segmentation/customhoughtransform.hpp"
 #include <iostream>
-#include <map>
+#include <algorithm>
 
 using namespace std;
 using namespace cv;
@@ -71,93 +71,144 @@ struct hough_cmp_gt
 
 
 
-/*
-Here image is an input raster;
-step is it's step; size characterizes it's ROI;
-rho and theta are discretization steps (in pixels and radians correspondingly).
-threshold is the minimum number of pixels in the feature for it
-to be a candidate for line. lines is the output
-array of (rho, theta) pairs. linesMax is the buffer size (number of pairs).
-Functions return the actual number of found lines.
-*/
-void HoughLinesCustom( const cv::Mat& img, float rho, float theta,
-                       double min_theta, double max_theta, int* accum,
-                       map<Vec2i, vector<int>, Vec2iCompare>* contributions)
+// true if point a comes before point b in raster order
+static inline bool rasterBefore (Vec2i a, Vec2i b)
 {
-    int i, j;
-    float irho = 1 / rho;
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
 
-    CV_Assert( img.type() == CV_8UC1 );
+int HoughContributions::find(Vec2i point) const
+{
+    if(!sorted)
+    {
+        sort(byPosition.begin(), byPosition.end(), [this](int a, int b) { return rasterBefore(points[a], points[b]); });
+        sorted = true;
+    }
 
-    const uchar* image = img.ptr();
-    int step = (int)img.step;
-    int width = img.cols;
-    int height = img.rows;
+    auto pos = lower_bound(byPosition.begin(), byPosition.end(), point,
+                           [this](int id, Vec2i p) { return rasterBefore(points[id], p); });
 
-    if (max_theta < min_theta ) {
-        CV_Error( CV_StsBadArg, "max_theta must be greater than min_theta" );
-    }
-    int numangle = cvRound((max_theta - min_theta) / theta);
-    int numrho = cvRound(((width + height) * 2 + 1) / rho);
+    if(pos == byPosition.end() || points[*pos] != point)
+        return -1;
+
+    return *pos;
+}
 
-#if defined HAVE_IPP && !defined(HAVE_IPP_ICV_ONLY) && IPP_VERSION_X100 >= 810 && IPP_DISABLE_BLOCK
-    CV_IPP_CHECK()
+int HoughContributions::add(Vec2i point)
+{
+    // points of a raster scan come in order, so
+    // the position index rarely needs to be sorted
+    bool inOrder = byPosition.empty() || rasterBefore(points[byPosition.back()], point);
+
+    if(!inOrder)
     {
-        IppiSize srcSize = { width, height };
-        IppPointPolar delta = { rho, theta };
-        IppPointPolar dstRoi[2] = {{(Ipp32f) -(width + height), (Ipp32f) min_theta},{(Ipp32f) (width + height), (Ipp32f) max_theta}};
-        int bufferSize;
-        int nz = countNonZero(img);
-        int ipp_linesMax = std::min(linesMax, nz*numangle/threshold);
-        int linesCount = 0;
-        lines.resize(ipp_linesMax);
-        IppStatus ok = ippiHoughLineGetSize_8u_C1R(srcSize, delta, ipp_linesMax, &bufferSize);
-        Ipp8u* buffer = ippsMalloc_8u(bufferSize);
-        if (ok >= 0) ok = ippiHoughLine_Region_8u32f_C1R(image, step, srcSize, (IppPointPolar*) &lines[0], dstRoi, ipp_linesMax, &linesCount, delta, threshold, buffer);
-        ippsFree(buffer);
-        if (ok >= 0)
-        {
-            lines.resize(linesCount);
-            CV_IMPL_ADD(CV_IMPL_IPP);
-            return;
-        }
-        lines.clear();
-        setIppErrorStatus();
+        int id = find(point);
+
+        if(id != -1)
+            return id;
     }
-#endif
 
-    AutoBuffer<float> _tabSin(numangle);
-    AutoBuffer<float> _tabCos(numangle);
-    float *tabSin = _tabSin, *tabCos = _tabCos;
+    int id = points.size();
+
+    points.push_back(point);
+    votedIn.push_back(0);
+    byPosition.push_back(id);
+    sorted = sorted && inOrder;
+
+    return id;
+}
+
+// Starts a voting pass; the sin/cos tables are the
+// ones of openCV's HoughLines.
+void HoughContributions::beginPass(float rho, float theta, double min_theta, int numangle, int numrho)
+{
+    CV_Assert(passes.size() < 8 * sizeof(unsigned));
+
+    float irho = 1 / rho;
+
+    Pass pass;
+    pass.numangle = numangle;
+    pass.numrho = numrho;
+    pass.tabSin.resize(numangle);
+    pass.tabCos.resize(numangle);
 
     float ang = static_cast<float>(min_theta);
     for(int n = 0; n < numangle; ang += theta, n++ )
     {
-        tabSin[n] = (float)(sin((double)ang) * irho);
-        tabCos[n] = (float)(cos((double)ang) * irho);
+        pass.tabSin[n] = (float)(sin((double)ang) * irho);
+        pass.tabCos[n] = (float)(cos((double)ang) * irho);
     }
 
-    // stage 1. fill accumulator
-    for( i = 0; i < height; i++ )
-        for( j = 0; j < width; j++ )
+    passes.push_back(pass);
+}
+
+// Adds (delta = 1) or removes (delta = -1) the votes
+// of point (i, j) in a pass.
+static void castVotes (int i, int j, int numangle, int numrho, const float* tabSin, const float* tabCos, int* accum, int delta)
+{
+    for(int n = 0; n < numangle; n++ )
+    {
+        int r = cvRound( j * tabCos[n] + i * tabSin[n] );
+        r += (numrho - 1) / 2;
+        accum[(n+1) * (numrho+2) + r+1] += delta; // contents of accum are expected to be >= 0.
+    }
+}
+
+void HoughContributions::vote(int id, int* accum)
+{
+    const int p = passes.size() - 1;
+    const Pass& pass = passes[p];
+
+    castVotes(points[id][0], points[id][1], pass.numangle, pass.numrho, pass.tabSin.data(), pass.tabCos.data(), accum, 1);
+    votedIn[id] |= 1u << p;
+}
+
+void HoughContributions::remove(int id, int* accum)
+{
+    for(int p = 0; p < (int) passes.size(); p++)
+        if(votedIn[id] & (1u << p))
         {
-            if( image[i * step + j] != 0 )
-            {
-                Vec2i inputPoint = Vec2i(i, j);// centroid coordinates
-                vector<int> cList; // associated accumulator positions
-
-                for(int n = 0; n < numangle; n++ )
-                {
-                    int r = cvRound( j * tabCos[n] + i * tabSin[n] );
-                    r += (numrho - 1) / 2;
-                    accum[(n+1) * (numrho+2) + r+1]++; // add to exposed accum; contents of accum are expected to be >= 0.
-                    cList.push_back((n+1) * (numrho+2) + r+1); // save accumulator position of contributed value
-                }
-
-                // associate all contribution positions with this input point
-                contributions->emplace(inputPoint, cList);
-            }
+            const Pass& pass = passes[p];
+            castVotes(points[id][0], points[id][1], pass.numangle, pass.numrho, pass.tabSin.data(), pass.tabCos.data(), accum, -1);
         }
+
+    // repeated removals of the same point don't change the accumulator
+    votedIn[id] = 0;
+}
+
+
+// Fills the accumulator with the votes of a list of (row, col) points
+// in an image of size imageSize, remembering which point voted. Unlike
+// openCV's HoughLines, it takes the points instead of the white pixels
+// of an image, so the cost depends on the number of points, not on the
+// image area.
+//
+// The accumulator gets the same votes as from an image with exactly
+// these pixels set: each position votes once, even if it is in the
+// list more than once. All points have to lie inside the image.
+void HoughLinesPoints (const vector<Vec2i>& points, Size imageSize, float rho, float theta,
+                       double min_theta, double max_theta, int* accum,
+                       HoughContributions* contributions)
+{
+    if (max_theta < min_theta ) {
+        CV_Error( CV_StsBadArg, "max_theta must be greater than min_theta" );
+    }
+    int numangle = cvRound((max_theta - min_theta) / theta);
+    int numrho = cvRound(((imageSize.width + imageSize.height) * 2 + 1) / rho);
+
+    // raster order without duplicates, so the points get their ids
+    // in order and are found by binary search in later passes
+    vector<Vec2i> positions(points);
+    sort(positions.begin(), positions.end(), rasterBefore);
+    positions.erase(unique(positions.begin(), positions.end()), positions.end());
+
+    contributions->beginPass(rho, theta, min_theta, numangle, numrho);
+
+    for(auto p = positions.begin(); p != positions.end(); p++)
+    {
+        CV_Assert((*p)[0] >= 0 && (*p)[0] < imageSize.height && (*p)[1] >= 0 && (*p)[1] < imageSize.width);
+        contributions->vote(contributions->add(*p), accum);
+    }
 }
 
 // Extracts polar Hough lines from a Hough accumulator.
@@ -222,24 +273,15 @@ void HoughLinesExtract (int* accum, int numrho, int numangle, float rho, float t
     }
 }
 
-// Deletes the contributions denoted by accumulator positions from the Hough accumulator.
-void deleteLineContributions (int* accumulator, Vec2i inputPoint, map<Vec2i, vector<int>, Vec2iCompare> contributions)
+// Deletes the contributions of an input point from the Hough accumulator
+// (all passes it voted in). Repeated deletions of the same input point
+// don't decrease the accumulator values again.
+void deleteLineContributions (int* accumulator, Vec2i inputPoint, HoughContributions* contributions)
 {
-    // do map lookup for input point
-    auto iter = contributions.find(inputPoint);
+    int id = contributions->find(inputPoint);
 
-    if(iter != contributions.end())
-    {
-        // delete all contributions in the list from accumulator
-        for(auto pos = (*iter).second.begin(); pos != (*iter).second.end(); pos++)
-            accumulator[*pos]--;
-
-        // delete entry for the input point from the map
-        // so repeated searches for the same input point
-        // don't decrease the accumulator values erroneously
-        vector<int> empty;
-        (*iter).second = empty;
-    }
+    if(id != -1)
+        contributions->remove(id, accumulator);
 }
 
 
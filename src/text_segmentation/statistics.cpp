@@ -6,10 +6,18 @@
   */
 
 #include "include/text_segmentation/statistics.hpp"
+#include "include/thresholdkernel.hpp"
 
 #include <random>
-#include <chrono>
 #include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HAVE_X86_KERNELS
+    #include <immintrin.h>
+#endif
 
 
 using namespace std;
@@ -22,33 +30,98 @@ template<
     typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type
 > struct S{};
 
-// Returns the median of the input list.
-template<typename T> double median (vector<T> elements)
+// Returns the q-quantile (0 <= q <= 1) of the n values, interpolated
+// linearly between the two closest order statistics (so q = 0.5 is the
+// median). The values are reordered: only the order statistics needed
+// are selected, in O(n) on average instead of sorting.
+template<typename T> double selectQuantile (T* values, int n, double q)
 {
-    static_assert(is_arithmetic<T>::value, "Non-arithmetic typed passed to median().");
+    static_assert(is_arithmetic<T>::value, "Non-arithmetic typed passed to selectQuantile().");
 
-    if(elements.size() == 0)
+    if(n <= 0)
         return 0.;
 
-    // sort list
-    sort(elements.begin(), elements.end());
+    double pos = q * (n - 1);
+    int lower = (int) floor(pos);
+    double weight = pos - lower;
+
+    nth_element(values, values + lower, values + n);
+    double low = values[lower];
+
+    if(weight == 0. || lower + 1 >= n)
+        return low;
+
+    // the next order statistic is the minimum of the upper part
+    double high = *min_element(values + lower + 1, values + n);
+
+    return low + weight * (high - low);
+}
+
+// Returns the median of the n values, which are reordered.
+template<typename T> double selectMedian (T* values, int n)
+{
+    if(n <= 0)
+        return 0.;
 
     // number of elements is odd
-    if((elements.size() % 2) == 1)
-    {
-        return elements.at(elements.size() / 2);
-    }
+    if(n % 2 == 1)
+        return selectQuantile(values, n, 0.5);
 
-    // number of elements is even
-    else
-        return 0.5 * (elements.at(((elements.size() + 1) / 2)) + elements.at(((elements.size() + 1) / 2) - 1));
+    // number of elements is even: mean of the two middle elements
+    nth_element(values, values + n / 2, values + n);
+    double high = values[n / 2];
+    double low = *max_element(values, values + n / 2);
+
+    return 0.5 * (high + low);
+}
+
+// Scratch buffer of the calling thread for the copying versions,
+// so repeated calls don't allocate.
+template<typename T> static vector<T>& scratch (const vector<T>& elements)
+{
+    static thread_local vector<T> buffer;
+
+    buffer.assign(elements.begin(), elements.end());
+    return buffer;
+}
+
+// Returns the q-quantile of the input list.
+template<typename T> double quantile (const vector<T>& elements, double q)
+{
+    vector<T>& copy = scratch(elements);
+    return selectQuantile(copy.data(), (int) copy.size(), q);
+}
+
+// Returns the median of the input list.
+template<typename T> double median (const vector<T>& elements)
+{
+    vector<T>& copy = scratch(elements);
+    return selectMedian(copy.data(), (int) copy.size());
+}
+
+template double selectQuantile (int*, int, double);
+template double selectQuantile (double*, int, double);
+template double selectMedian (int*, int);
+template double selectMedian (double*, int);
+template double quantile (const vector<int>&, double);
+template double quantile (const vector<double>&, double);
+template double median (const vector<int>&);
+template double median (const vector<double>&);
+
+// Computes the medians of many groups of values in one call
+// (e.g. the residuals of all trials of a line fit).
+void batchMedians (double* values, const int* offsets, int groups, double* medians)
+{
+    for(int g = 0; g < groups; g++)
+        medians[g] = selectMedian(values + offsets[g], offsets[g + 1] - offsets[g]);
 }
 
 // Perform Least Squares for a 2D-line.
-parametricLine leastSquaresLine(std::vector<ConnectedComponent> cluster)
+// (using pos in list as x and the MBR area at pos x as y)
+parametricLine leastSquaresLine(const std::vector<int>& areas)
 {
     // only one data point, fitting impossible
-    assert(cluster.size() > 1);
+    assert(areas.size() > 1);
 
     double reci_term, reci_term_2, m, m_2, m_3, b, b_2, b_3, b_4;
     reci_term = reci_term_2 = m = m_2 = m_3 = b = b_2 = b_3 = b_4 = 0.;
@@ -57,57 +130,57 @@ parametricLine leastSquaresLine(std::vector<ConnectedComponent> cluster)
     // (using pos in list as x and area of component at pos x as y)
 
     // reci_term: n * (sum(i=1 to n) [(x_i)^2]) - (sum(i=1 to n) [x_i])^2
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
         reci_term += (i * i);
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
         reci_term_2 += i;
     }
     reci_term_2 *= reci_term_2;
-    reci_term = (reci_term * cluster.size()) - reci_term_2;
+    reci_term = (reci_term * areas.size()) - reci_term_2;
 
 
     // m^-1: n * (sum(i=1 to n) [x_i * y_i]) - (sum(i=1 to n) [x_i]) * sum(i=1 to n) [y_i])
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
-        m += (i * cluster.at(i).area);
+        m += (i * areas.at(i));
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
         m_2 += i;
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
-        m_3 += cluster.at(i).area;
+        m_3 += areas.at(i);
     }
 
-    m = (cluster.size() * m) - (m_2 * m_3);
+    m = (areas.size() * m) - (m_2 * m_3);
 
 
     // b^-1: ((sum(i=1 to n) [(x_i)^2]) * (sum(i=1 to n) [y_i])) - (sum(i=1 to n) [x_i] * sum(i=1) to n)[x_i * y_i])
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
         b += (i * i);
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
-        b_2 += cluster.at(i).area;
+        b_2 += areas.at(i);
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
         b_3 += i;
     }
 
-    for(int i = 0; i < (int) cluster.size(); i++)
+    for(int i = 0; i < (int) areas.size(); i++)
     {
-        b_4 += (i * cluster.at(i).area);
+        b_4 += (i * areas.at(i));
     }
 
     b = (b * b_2) - (b_3 * b_4);
@@ -124,68 +197,161 @@ parametricLine leastSquaresLine(std::vector<ConnectedComponent> cluster)
     return line;
 }
 
-// Perform Least Median Squares for a 2D-line, that is, for k = 2.
+// --------------------- Least Median Squares -------------------------
+
+// Squared errors of the line m * x + b for the values y at x = 0 .. n-1.
+static void squaredErrorsScalar (const double* y, int from, int n, double m, double b, double* errors)
+{
+    for(int i = from; i < n; i++)
+    {
+        double e = y[i] - (m * i + b);
+        errors[i] = e * e;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse2")))
+static void squaredErrorsSSE2 (const double* y, int n, double m, double b, double* errors)
+{
+    const __m128d vm = _mm_set1_pd(m), vb = _mm_set1_pd(b), step = _mm_set1_pd(2.);
+    __m128d x = _mm_set_pd(1., 0.);
+    int i = 0;
+
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d e = _mm_sub_pd(_mm_loadu_pd(y + i), _mm_add_pd(_mm_mul_pd(vm, x), vb));
+        _mm_storeu_pd(errors + i, _mm_mul_pd(e, e));
+        x = _mm_add_pd(x, step);
+    }
+
+    squaredErrorsScalar(y, i, n, m, b, errors);
+}
+
+__attribute__((target("avx2")))
+static void squaredErrorsAVX2 (const double* y, int n, double m, double b, double* errors)
+{
+    // no FMA, so the errors are the same as those of the scalar version
+    const __m256d vm = _mm256_set1_pd(m), vb = _mm256_set1_pd(b), step = _mm256_set1_pd(4.);
+    __m256d x = _mm256_set_pd(3., 2., 1., 0.);
+    int i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d e = _mm256_sub_pd(_mm256_loadu_pd(y + i), _mm256_add_pd(_mm256_mul_pd(vm, x), vb));
+        _mm256_storeu_pd(errors + i, _mm256_mul_pd(e, e));
+        x = _mm256_add_pd(x, step);
+    }
+
+    squaredErrorsScalar(y, i, n, m, b, errors);
+}
+#endif
+
+static void squaredErrors (const double* y, int n, double m, double b, double* errors)
+{
+#ifdef HAVE_X86_KERNELS
+    const int level = thresholdKernelLevel();
+
+    if(level == KERNEL_AVX2)
+        return squaredErrorsAVX2(y, n, m, b, errors);
+    if(level == KERNEL_SSE2)
+        return squaredErrorsSSE2(y, n, m, b, errors);
+#endif
+
+    squaredErrorsScalar(y, 0, n, m, b, errors);
+}
+
+// Evaluates LMS trials: the squared errors of each trial's line
+// (at errors + offsets[trial]) and their median.
+class LMSTrialBody : public ParallelLoopBody
+{
+public:
+    LMSTrialBody(const vector<double>& y, const vector<parametricLine>& lines, const int* offsets, double* errors, double* e_med)
+        : y(y), lines(lines), offsets(offsets), errors(errors), e_med(e_med)
+    {}
+
+    void operator() (const Range& trials) const
+    {
+        for(int trial = trials.start; trial < trials.end; trial++)
+            squaredErrors(y.data(), y.size(), lines[trial].m, lines[trial].b, errors + offsets[trial]);
+
+        batchMedians(errors, offsets + trials.start, trials.end - trials.start, e_med + trials.start);
+    }
+
+private:
+    const vector<double>& y;
+    const vector<parametricLine>& lines;
+    const int* offsets;
+    double* errors;
+    double* e_med;
+};
+
+// Perform Least Median Squares for a 2D-line, that is, for k = 2,
+// with the position in the list as x and the area as y.
 //
 // p = needed probability of 1 non-outlier in m_min
 // t = assumed percentage of outliers in entire set
-parametricLine leastMedianSquaresLine(std::vector<ConnectedComponent> cluster, float p, float t)
+//
+// The trials are drawn from a generator seeded with "seed", so the same
+// input always gives the same line. If "parallel" is set, the trials
+// are evaluated in parallel (worth it for large inputs only); the
+// result doesn't depend on it. Without areas, the line is y = 0.
+parametricLine leastMedianSquaresLine(const std::vector<int>& areas, float p, float t, unsigned seed, bool parallel)
 {
+    const int n = areas.size();
+    parametricLine finalLine = { 0., 0. }; // final fitted line parameters
+
+    // no points to draw the trials from
+    if(n == 0)
+        return finalLine;
+
     // Setup robust line fitting
-    double e_min = INT_MAX; // current error
+    double e_min = numeric_limits<double>::infinity(); // current error
     int k = 2; // number of parameters needed to define suspected fitting function (here: line)
-    int m_min = ceil(log(1 - p) / log(1 - pow((1 - t), k))); // number of random points that are inspected
-    parametricLine finalLine; // final fitted line parameters
+    int m_min = max(1., ceil(log(1 - p) / log(1 - pow((1 - t), k)))); // number of random points that are inspected
 
-    // Setup random number generator
-    typedef std::chrono::high_resolution_clock clock;
-    clock::time_point beginning = clock::now();
-    clock::duration d = clock::now() - beginning;
-
-    unsigned seed = d.count();
     std::minstd_rand0 rnd(seed);
+    const vector<double> y(areas.begin(), areas.end());
 
+    vector<parametricLine> lines(m_min); // fitted line of each trial
+    vector<double> errors((size_t) m_min * n); // squared errors of all trials, trial by trial
+    vector<int> offsets(m_min + 1);
+    vector<double> e_med(m_min); // median of squared errors of each trial
 
-    // Perform fitting by Least Median Squares (LMS)
-    for(int i = 0; i < m_min; i++)
-    {
-        vector<ConnectedComponent> subSample;
-        parametricLine line;
-        vector<double> errors;
-        double e_med; // median of squared errors
+    for(int trial = 0; trial <= m_min; trial++)
+        offsets[trial] = trial * n;
 
-        // find k random points p = (pos, area)
-        for(int i = 0; i < k; i++)
-        {
-            uniform_int_distribution<> dis(0, distance(cluster.begin(), cluster.end()) - 1);
-            subSample.push_back(cluster.at(dis(rnd)));
-        }
+    // Find k = 2 random points for each trial and fit the line through them.
+    // Like leastSquaresLine does for two points, the line is fitted to
+    // (0, first area) and (1, second area): m = a1 - a0, b = a0.
+    uniform_int_distribution<> dis(0, n - 1);
 
-        // calculate least squares for subsample
-        line = leastSquaresLine(subSample);
+    for(int trial = 0; trial < m_min; trial++)
+    {
+        double a0 = y[dis(rnd)];
+        double a1 = y[dis(rnd)];
 
-        // calculate median error for fitted line
-        for(int i = 0; i < (int) cluster.size(); i++)
-        {
-            // squared error: y-difference from prognosis y value
-            double cur = abs((cluster.at(i).area) - (line.m * i + line.b));
-            cur *= cur;
+        lines[trial].m = a1 - a0;
+        lines[trial].b = a0;
+    }
 
-            errors.push_back(cur);
-        }
+    // Perform fitting by Least Median Squares (LMS)
+    LMSTrialBody trials(y, lines, offsets.data(), errors.data(), e_med.data());
 
-        e_med = median(errors);
+    if(parallel)
+        parallel_for_(Range(0, m_min), trials);
+    else
+        trials(Range(0, m_min));
 
+    for(int i = 0; i < m_min; i++)
+    {
         // accept these parameters only if they are
         // better than the previous parameters
-        if(e_med < e_min)
+        if(e_med[i] < e_min)
         {
-            e_min = e_med;
-            finalLine = line;
+            e_min = e_med[i];
+            finalLine = lines[i];
         }
     }
 
     return finalLine;
 }
-
-
-
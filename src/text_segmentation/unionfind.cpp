@@ -2,29 +2,46 @@
   * This class provides an implementation of the "Union-Find" data structure.
   *
   * Author: Kartik Kukreja (https://kartikkukreja.wordpress.com)
+  *
+  * The lock-free ConcurrentUnionFind follows R. J. Anderson and H. Woll,
+  * "Wait-free Parallel Algorithms for the Union-Find Problem".
+  * Author: phugen
   */
 
 #include "include/text_segmentation/unionfind.hpp"
 
+#include <algorithm>
+
+using namespace std;
+
 
 // Create an empty union find data structure with N isolated sets.
 UnionFind::UnionFind(int N)
 {
     cnt = N;
-    id = new int[N];
-    sz = new int[N];
+    id.resize(N);
+    sz.assign(N, 1);
 
     for(int i=0; i<N; i++)
-    {
         id[i] = i;
-        sz[i] = 1;
-    }
 }
 
-UnionFind::~UnionFind()
+// Add a new isolated set and return its id (= the old size).
+int UnionFind::add()
+{
+    int p = id.size();
+
+    id.push_back(p);
+    sz.push_back(1);
+    cnt++;
+
+    return p;
+}
+
+// Number of objects (not sets).
+int UnionFind::size()
 {
-    delete [] id;
-    delete [] sz;
+    return id.size();
 }
 
 // Return the id of component corresponding to object p.
@@ -79,3 +96,105 @@ int UnionFind::count()
 {
     return cnt;
 }
+
+
+// Create a union find data structure with N isolated sets.
+ConcurrentUnionFind::ConcurrentUnionFind(int N)
+    : n(0), cnt(0)
+{
+    reset(N);
+}
+
+// Start over with N isolated sets (not thread-safe).
+void ConcurrentUnionFind::reset(int N)
+{
+    if(N != n)
+        id.reset(N > 0 ? new atomic<int>[N] : NULL);
+
+    for(int i = 0; i < N; i++)
+        id[i].store(i, memory_order_relaxed);
+
+    n = N;
+    cnt.store(N);
+}
+
+// Number of objects (not sets).
+int ConcurrentUnionFind::size()
+{
+    return n;
+}
+
+// Return the id of component corresponding to object p.
+//
+// Path halving: every visited object is pointed at its grandparent.
+// A failed compare-and-swap means another thread already moved it
+// further up, so it is simply skipped.
+int ConcurrentUnionFind::find(int p)
+{
+    while(true)
+    {
+        int parent = id[p].load(memory_order_relaxed);
+
+        if(parent == p)
+            return p;
+
+        int grandparent = id[parent].load(memory_order_relaxed);
+
+        if(grandparent != parent)
+            id[p].compare_exchange_weak(parent, grandparent, memory_order_relaxed);
+
+        p = grandparent;
+    }
+}
+
+// Replace sets containing x and y with their union.
+void ConcurrentUnionFind::merge(int x, int y)
+{
+    while(true)
+    {
+        x = find(x);
+        y = find(y);
+
+        if(x == y)
+            return;
+
+        // link the larger root below the smaller one
+        if(x < y)
+            swap(x, y);
+
+        // fails if x stopped being a root in the meantime: try again
+        int expected = x;
+        if(id[x].compare_exchange_strong(expected, y, memory_order_relaxed))
+        {
+            cnt.fetch_sub(1, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+// Are objects x and y in the same set?
+bool ConcurrentUnionFind::connected(int x, int y)
+{
+    while(true)
+    {
+        x = find(x);
+        y = find(y);
+
+        if(x == y)
+            return true;
+
+        // the larger root can only be linked below a smaller one; if it
+        // is still a root, the sets were different when it was checked
+        if(x < y)
+            swap(x, y);
+
+        if(id[x].load(memory_order_relaxed) == x)
+            return false;
+    }
+}
+
+// Return the number of disjoint sets.
+int ConcurrentUnionFind::count()
+{
+    return cnt.load(memory_order_relaxed);
+}
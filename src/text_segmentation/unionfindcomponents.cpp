@@ -1,6 +1,7 @@
 /**
   * Provides a means of breaking down a binary image into
   * isolated connected components by using two-pass connected-component labeling.
+  * The first pass labels 2x2 blocks (see blocklabeling.cpp).
   *
   * (https://en.wikipedia.org/wiki/Connected-component_labeling)
   *
@@ -9,323 +10,575 @@
 
 #include "include/text_segmentation/unionfindcomponents.hpp"
 #include "include/text_segmentation/unionfind.hpp"
+#include "include/text_segmentation/blocklabeling.hpp"
 #include "include/text_segmentation/auxiliary.hpp"
 #include "include/text_segmentation/colorconversions.hpp"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
+#include "include/binaryimage.hpp"
 
 #include <iostream>
-#include <set>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 
 using namespace std;
 using namespace cv;
 
 
 
-// Expects binary picture (e.g. black layer)
-// If a component has less than minPx pixels, it is removed from the image
-// to stop unnecessary components from being evaluated.
-void unionFindComponents(Mat* input, vector<ConnectedComponent>* components, int minPx)
+// Checks if a MBR touches any of the image sides in "sides".
+bool touchesSides (Vec2i mbr_min, Vec2i mbr_max, int sides, int rows, int cols)
 {
-    const int rows = input->rows; // shortcuts
-    const int cols = input->cols;
-
-    int label = 1; // number of first component
-    vector<int> labels = vector<int>(rows * cols, 0); // keeps track of which pixel belongs to which component, 0 = "background"
-    int* pxPerLabel; // number of black pixels in label
-    Vec2i* seedPerLabel; // seed[label] = coordinates of the first black pixel in the component
+    return ((sides & SIDE_TOP) && mbr_min[0] == 0) ||
+           ((sides & SIDE_BOTTOM) && mbr_max[0] == rows - 1) ||
+           ((sides & SIDE_LEFT) && mbr_min[1] == 0) ||
+           ((sides & SIDE_RIGHT) && mbr_max[1] == cols - 1);
+}
 
-    UnionFind* uf; // union-find data structure
-    vector<Vec2i> neighborPositions; // (x,y) positions of all black neighbors of current pixel
-    vector<int> nb_labels; // contains the labels of the neighbors of a pixel
-    set<int> trueLabels; // contains the actually valid labels.
+// true if pixel a comes before pixel b in raster order
+static inline bool rasterBefore (Vec2i a, Vec2i b)
+{
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
 
-    Vec2i** MBRCoords; // contains min- and max points of each component's MBR
+// pixel rows of a strip of block rows
+static inline Range stripRows (const BlockLabels& blocks, int s, int rows)
+{
+    return Range(2 * blocks.stripStart[s], min(rows, 2 * blocks.stripStart[s + 1]));
+}
 
-    // initialize black pixel count per label
-    pxPerLabel = new int[rows * cols];
-    for(int i = 0; i < (rows * cols); i++)
-        pxPerLabel[i] = 0;
+// Per-label statistics: pixel count, first pixel, MBR min and max
+struct LabelTables
+{
+    int* px;
+    Vec2i* seed;
+    Vec2i* mbrMin;
+    Vec2i* mbrMax;
+};
+
+// Collects the statistics of the provisional labels strip by strip.
+// The strips have disjoint label ranges, so no entry is shared.
+class LabelStatisticsBody : public ParallelLoopBody
+{
+public:
+    LabelStatisticsBody(const BinaryImage& black, const BlockLabels& blocks, LabelTables tables)
+        : black(black), blocks(blocks), tables(tables)
+    {}
 
-    // initialize label->seed lookup table
-    // with dummy values
-    seedPerLabel = new Vec2i[rows * cols];
-    for (int i = 0; i < (rows * cols); i++)
+    void operator() (const Range& strips) const
     {
-        seedPerLabel[i] = Vec2i(-1, -1);
+        for(int s = strips.start; s < strips.end; s++)
+        {
+            Range rows = stripRows(blocks, s, black.rows());
+
+            for(int i = rows.start; i < rows.end; i++)
+                for(int w = 0; w < black.words(); w++)
+                    for(uint64_t word = black.row(i)[w]; word != 0; word &= word - 1) // check only black pixels
+                    {
+                        int j = w * 64 + lowestBit(word);
+                        int l = blocks.at(i, j);
+
+                        // first pixel of the label
+                        if(tables.px[l] == 0)
+                        {
+                            tables.seed[l] = Vec2i(i, j);
+                            tables.mbrMin[l] = Vec2i(i, j);
+                            tables.mbrMax[l] = Vec2i(i, j);
+                        }
+
+                        tables.px[l] += 1;
+
+                        // rows only grow in raster order
+                        tables.mbrMin[l][1] = min(tables.mbrMin[l][1], j);
+                        tables.mbrMax[l][0] = i;
+                        tables.mbrMax[l][1] = max(tables.mbrMax[l][1], j);
+                    }
+        }
     }
 
-    // initialize MBR coordinate array
-    MBRCoords = new Vec2i*[rows * cols];
-    for(int i = 0; i < (rows * cols); i++)
-        MBRCoords[i] = new Vec2i[2];
+private:
+    const BinaryImage& black;
+    const BlockLabels& blocks;
+    LabelTables tables;
+};
 
-    // initialize MBR values with dummy values
-    for (int i = 0; i < rows; i++)
-        for (int j = 0; j < cols; j++)
+// Finalize pass: writes the final component label of each pixel
+// (0 = background) and clears the pixels of removed components
+// in the input in the same sweep.
+class LabelImageBody : public ParallelLoopBody
+{
+public:
+    LabelImageBody(const BinaryImage& black, const BlockLabels& blocks, const int* componentOf, const uchar* removed,
+                   Mat* labels, Mat* input)
+        : black(black), blocks(blocks), componentOf(componentOf), removed(removed), labels(labels), input(input)
+    {}
+
+    void operator() (const Range& strips) const
+    {
+        for(int s = strips.start; s < strips.end; s++)
         {
-            MBRCoords[(i * cols) + j][0] = Vec2i(INT_MAX, INT_MAX);
-            MBRCoords[(i * cols) + j][1] = Vec2i(-1, -1);
+            Range rows = stripRows(blocks, s, black.rows());
+
+            for(int i = rows.start; i < rows.end; i++)
+            {
+                int* labelRow = labels->ptr<int>(i);
+                uchar* inputRow = input->ptr<uchar>(i);
+
+                memset(labelRow, 0, sizeof(int) * black.cols());
+
+                for(int w = 0; w < black.words(); w++)
+                    for(uint64_t word = black.row(i)[w]; word != 0; word &= word - 1)
+                    {
+                        int j = w * 64 + lowestBit(word);
+                        int component = componentOf[blocks.at(i, j)];
+
+                        // erased pixels are background in the label image, too
+                        if(removed[component])
+                            inputRow[j] = 255;
+                        else
+                            labelRow[j] = component;
+                    }
+            }
         }
+    }
+
+private:
+    const BinaryImage& black;
+    const BlockLabels& blocks;
+    const int* componentOf;
+    const uchar* removed;
+    Mat* labels;
+    Mat* input;
+};
+
+// Finds the horizontal runs of black pixels, strip by strip, together
+// with the component each run belongs to.
+class RunsBody : public ParallelLoopBody
+{
+public:
+    RunsBody(const BinaryImage& black, const BlockLabels& blocks, const int* componentOf, vector<vector<pair<int, PixelRun> > >* stripRuns)
+        : black(black), blocks(blocks), componentOf(componentOf), stripRuns(stripRuns)
+    {}
 
-    // initialize union-find
-    uf = new UnionFind(rows * cols);
+    void operator() (const Range& strips) const
+    {
+        vector<Vec2i> rowRuns;
+
+        for(int s = strips.start; s < strips.end; s++)
+        {
+            Range rows = stripRows(blocks, s, black.rows());
+            vector<pair<int, PixelRun> >& found = (*stripRuns)[s];
 
-    // First pass: Assign labels to pixels. Some of the labels might be
-    // equivalent and will be "translated" in the second pass.
-    for (int i = 0; i < rows; i++)
-        for(int j = 0; j < cols; j++)
-            if(input->at<uchar>(i, j) == 0) // check only black pixels
+            for(int i = rows.start; i < rows.end; i++)
             {
-                // reset neighbor list
-                neighborPositions.clear();
-
-                // 8 EDGE CASES,
-                // 1 NORMAL CASE:
-                //
-                // Consider only pixels "known" pixels, i.e. pixels above the scan line or
-                // the pixel's left neighbor - the right neighbor and all pixels below will
-                // check above and left of them as well in their iteration
-                //
-                // top left pixel
-                if(i == 0 && j == 0)
-                {
-                    // always defines a new region
-                }
+                black.runs(i, &rowRuns);
 
-                // top right pixel
-                else if(i == 0 && j == (cols - 1))
+                // a run is 8-connected, so any of its pixels gives its component
+                for(auto run = rowRuns.begin(); run != rowRuns.end(); run++)
                 {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
+                    PixelRun r = { i, (*run)[0], (*run)[1] };
+                    found.push_back(make_pair(componentOf[blocks.at(i, r.colStart)], r));
                 }
+            }
+        }
+    }
 
+private:
+    const BinaryImage& black;
+    const BlockLabels& blocks;
+    const int* componentOf;
+    vector<vector<pair<int, PixelRun> > >* stripRuns;
+};
+
+// Stores the runs of all kept components in "runs", grouped by component
+// (in the order of "components") and sorted by row, and sets firstRun and
+// numRuns of the components. keptAs maps a component label to its index
+// in "components" (-1 = removed, its runs are dropped).
+static void collectRuns (const BinaryImage& black, const BlockLabels& blocks, const vector<int>& componentOf,
+                         const vector<int>& keptAs, vector<ConnectedComponent>* components, vector<PixelRun>* runs)
+{
+    vector<vector<pair<int, PixelRun> > > stripRuns(blocks.strips());
+    parallel_for_(Range(0, blocks.strips()), RunsBody(black, blocks, componentOf.data(), &stripRuns), blocks.strips());
 
-                // bottom left pixel
-                else if (i == (rows - 1) && j == 0)
-                {
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                    if(input->at<uchar>(i-1, j+1) == 0) neighborPositions.push_back(Vec2i(i-1, j+1));
-                }
+    // counting sort by component; the strips are in row order
+    for(auto strip = stripRuns.begin(); strip != stripRuns.end(); strip++)
+        for(auto run = (*strip).begin(); run != (*strip).end(); run++)
+            if(keptAs[(*run).first] != -1)
+                (*components)[keptAs[(*run).first]].numRuns++;
 
-                // bottom right pixel
-                else if (i == (rows - 1) && j == (cols - 1))
-                {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
-                    if(input->at<uchar>(i-1, j-1) == 0) neighborPositions.push_back(Vec2i(i-1, j-1));
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                }
+    int total = 0;
 
-                // if we were in a corner, the appropriate
-                // if-branch would have been triggered already,
-                // so inspect only one dimension condition now.
-                //
-                // upper border
-                else if (i == 0)
-                {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
-                }
+    for(auto comp = components->begin(); comp != components->end(); comp++)
+    {
+        (*comp).firstRun = total;
+        total += (*comp).numRuns;
+    }
 
-                // left border
-                else if (j == 0)
-                {
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                    if(input->at<uchar>(i-1, j+1) == 0) neighborPositions.push_back(Vec2i(i-1, j+1));
-                }
+    runs->resize(total);
+    vector<int> next(components->size());
 
-                // right border
-                else if (j == (cols - 1))
-                {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
-                    if(input->at<uchar>(i-1, j-1) == 0) neighborPositions.push_back(Vec2i(i-1, j-1));
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                }
+    for(size_t c = 0; c < components->size(); c++)
+        next[c] = (*components)[c].firstRun;
 
-                // lower border
-                else if (i == (rows - 1))
-                {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
-                    if(input->at<uchar>(i-1, j-1) == 0) neighborPositions.push_back(Vec2i(i-1, j-1));
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                    if(input->at<uchar>(i-1, j+1) == 0) neighborPositions.push_back(Vec2i(i-1, j+1));
-                }
+    for(auto strip = stripRuns.begin(); strip != stripRuns.end(); strip++)
+        for(auto run = (*strip).begin(); run != (*strip).end(); run++)
+            if(keptAs[(*run).first] != -1)
+                (*runs)[next[keptAs[(*run).first]]++] = (*run).second;
+}
 
-                // Normal case - pixel is somewhere
-                // in the image, but not near any border.
-                else
-                {
-                    if(input->at<uchar>(i, j-1) == 0) neighborPositions.push_back(Vec2i(i, j-1));
-                    if(input->at<uchar>(i-1, j-1) == 0) neighborPositions.push_back(Vec2i(i-1, j-1));
-                    if(input->at<uchar>(i-1, j) == 0) neighborPositions.push_back(Vec2i(i-1, j));
-                    if(input->at<uchar>(i-1, j+1) == 0) neighborPositions.push_back(Vec2i(i-1, j+1));
-                }
+// Expects binary picture (e.g. black layer)
+// If a component has less than minPx pixels, it is removed from the image
+// to stop unnecessary components from being evaluated.
+//
+// Large images are labeled in horizontal strips in parallel; the
+// components, their order and their labels don't depend on that.
+//
+// If the image is a tile of a larger sheet, seamSides marks the sides
+// that border other tiles. Components touching them may continue in
+// the neighboring tile, so they are never removed by the pixel filter.
+// If labelImage isn't NULL, it receives the final label of each pixel
+// (CV_32S, 0 = background); components refer to it by their label, so
+// a component can be erased by a sweep over its MBR (see eraseLabel).
+// If runs isn't NULL, it receives the horizontal pixel runs of all kept
+// components, grouped by component and sorted by row; each component
+// refers to its runs by firstRun and numRuns (see eraseComponentRuns).
+// Both outputs are optional and independent of each other.
+//
+// Returns the number of labels used (1 .. n, kept or not).
+int unionFindComponents(Mat* input, vector<ConnectedComponent>* components, int minPx, int seamSides, Mat* labelImage,
+                        vector<PixelRun>* runs)
+{
+    ScopedStageTimer timer("unionFindComponents");
 
-                // if there were no black neighbors
-                if(neighborPositions.size() == 0)
-                {
-                    // set MBR to pixel value
-                    MBRCoords[label][0] = Vec2i(i, j);
-                    MBRCoords[label][1] = Vec2i(i, j);
-
-                    // update label, seed and black pixel count
-                    // for this label
-                    labels[i * cols + j] = label;
-                    seedPerLabel[label] = Vec2i(i, j);
-                    pxPerLabel[label] = 1;
-
-                    // next black pixel could be a new label
-                    label += 1;
-                }
+    const int rows = input->rows; // shortcuts
+    const int cols = input->cols;
 
-                else
-                {
-                    // reset list of neighbor labels
-                    nb_labels.clear();
+    // keeps track of which pixel belongs to which component, 0 = "background";
+    // written straight into labelImage if the caller wants it
+    Mat localLabels;
+    Mat& labels = labelImage != NULL ? *labelImage : localLabels;
 
-                    // begin with the first label ...
-                    Vec2i first = neighborPositions.front();
-                    int minLabel = labels[first[0] * cols + first[1]];
+    labels.create(rows, cols, CV_32S); // zeroed by the finalize pass
 
-                    // look at all neighbors' labels
-                    for(vector<Vec2i>::iterator nbpIter = neighborPositions.begin(); nbpIter != neighborPositions.end(); nbpIter++)
-                    {
-                        Vec2i nPos = *nbpIter;
+    // packed copy of the input: black pixels are set bits
+    BinaryImage black(*input);
 
-                        // save labels for each neighbor
-                        nb_labels.push_back(labels[nPos[0] * cols + nPos[1]]);
+    // First pass: Label the 2x2 blocks of the image (in parallel strips). Some
+    // of the labels might be equivalent and will be "translated" in the second pass.
+    BlockLabels blocks;
+    ConcurrentUnionFind uf; // union-find data structure, one set per block label
 
-                        // find smallest label
-                        minLabel = min(minLabel, labels[nPos[0] * cols + nPos[1]]);
-                    }
+    labelBlocks(black, &blocks, &uf);
 
-                    // assign smallest label to current pixel, update seed
-                    // and increase black pixel counter
-                    labels[i * cols + j] = minLabel;
-                    seedPerLabel[minLabel] = Vec2i(i, j);
-                    pxPerLabel[minLabel] += 1;
-
-                    // if the newly labelled pixel changes the MBR
-                    // of that label's region, update it
-                    (MBRCoords[minLabel][0])[0] = min((MBRCoords[minLabel][0])[0], i);
-                    (MBRCoords[minLabel][0])[1] = min((MBRCoords[minLabel][0])[1], j);
-                    (MBRCoords[minLabel][1])[0] = max((MBRCoords[minLabel][1])[0], i);
-                    (MBRCoords[minLabel][1])[1] = max((MBRCoords[minLabel][1])[1], j);
-
-                    // merge components
-                    for (vector<int>::iterator nblIter = nb_labels.begin(); nblIter != nb_labels.end(); nblIter++)
-                        uf->merge(minLabel, *nblIter);
-                }
-            }
+    // Pixel count, seed and MBR of each provisional label (index 0 = background).
+    // They grow with the labels issued instead of the image size.
+    vector<int> pxOfLabel(blocks.count + 1, 0);
+    vector<Vec2i> seedOfLabel(blocks.count + 1), minOfLabel(blocks.count + 1), maxOfLabel(blocks.count + 1);
 
+    LabelTables tables = { pxOfLabel.data(), seedOfLabel.data(), minOfLabel.data(), maxOfLabel.data() };
+    parallel_for_(Range(0, blocks.strips()), LabelStatisticsBody(black, blocks, tables), blocks.strips());
 
     // Second pass: Translate labels (merge equivalent labels) by searching for
-    // the set that contains the label and then using it as the "true" label.
-    for (int i = 0; i < rows; i++)
-        for(int j = 0; j < cols; j++)
+    // the set that contains the label and then using it as the "true" label;
+    // the statistics of all labels of a set are reduced into its root.
+    // The root of each label is looked up only once.
+    vector<int> roots;
+    vector<int> rootOf(blocks.count + 1, 0);
+
+    for(int l = 1; l <= blocks.count; l++)
+    {
+        int root = uf.find(l);
+        rootOf[l] = root;
+
+        if(root == l)
         {
-            int oldLabel = labels[i * cols + j];
-            int newLabel = uf->find(labels[i * cols + j]);
+            roots.push_back(l);
+            continue;
+        }
 
-            // skip unused components
-            if(!isValidCoord(MBRCoords[oldLabel]))
-                continue;
+        pxOfLabel[root] += pxOfLabel[l];
 
-            // if sets were merged ...
-            if(oldLabel != newLabel)
-            {
-                // update MBR bounds if necessary
-                (MBRCoords[newLabel][0])[0] = min((MBRCoords[newLabel][0])[0], (MBRCoords[oldLabel][0])[0]);
-                (MBRCoords[newLabel][0])[1] = min((MBRCoords[newLabel][0])[1], (MBRCoords[oldLabel][0])[1]);
-                (MBRCoords[newLabel][1])[0] = max((MBRCoords[newLabel][1])[0], (MBRCoords[oldLabel][1])[0]);
-                (MBRCoords[newLabel][1])[1] = max((MBRCoords[newLabel][1])[1], (MBRCoords[oldLabel][1])[1]);
-
-                // update seed; since it doesn't matter which
-                // one is chosen, just choose the new one
-                //
-                // actually, this should be useless. TODO
-                seedPerLabel[oldLabel] = seedPerLabel[newLabel];
-
-                // and add one to the new label's pixel count
-                // for every pixel that was changed
-                pxPerLabel[newLabel] += 1;
-            }
+        if(rasterBefore(seedOfLabel[l], seedOfLabel[root]))
+            seedOfLabel[root] = seedOfLabel[l];
 
-            // update label value and record actually used labels
-            labels[i* cols + j] = uf->find(labels[i * cols + j]);
-            trueLabels.insert(uf->find(labels[i * cols + j]));
-        }
+        minOfLabel[root] = Vec2i(min(minOfLabel[root][0], minOfLabel[l][0]), min(minOfLabel[root][1], minOfLabel[l][1]));
+        maxOfLabel[root] = Vec2i(max(maxOfLabel[root][0], maxOfLabel[l][0]), max(maxOfLabel[root][1], maxOfLabel[l][1]));
+    }
 
-    cout << "Connected component analysis done." << "\n";
+    // components are numbered in the order their first pixel is found,
+    // so the result doesn't depend on the strips
+    sort(roots.begin(), roots.end(), [&seedOfLabel](int a, int b) { return rasterBefore(seedOfLabel[a], seedOfLabel[b]); });
 
+    int numTrueComponents = roots.size();
+    vector<int> componentOf(blocks.count + 1, 0);
 
-    int numTrueComponents = trueLabels.size();
-    cout << "Number of components found: " << numTrueComponents << "\n";
+    // Per-component tables (index 0 = background)
+    vector<int> pxPerLabel(1, 0); // number of black pixels in component
+    vector<Vec2i> seedPerLabel(1, Vec2i(-1, -1)); // seed[label] = coordinates of the first black pixel in the component
+    vector<Vec2i> mbrMin(1, Vec2i(INT_MAX, INT_MAX)); // min. point of each component's MBR
+    vector<Vec2i> mbrMax(1, Vec2i(-1, -1)); // max. point of each component's MBR
 
+    for(int k = 0; k < numTrueComponents; k++)
+    {
+        int root = roots[k];
+
+        componentOf[root] = k + 1;
+        pxPerLabel.push_back(pxOfLabel[root]);
+        seedPerLabel.push_back(seedOfLabel[root]);
+        mbrMin.push_back(minOfLabel[root]);
+        mbrMax.push_back(maxOfLabel[root]);
+    }
+
+    for(int l = 1; l <= blocks.count; l++)
+        componentOf[l] = componentOf[rootOf[l]];
+
+    // Skip components which include too few
+    // black pixels. The lower limit should be one for which
+    // it is hard to imagine that any letter that is of reasonable size
+    // could be drawn with less pixels than the limit.
+    //
+    // Idea: Find minPx dynamically by constructing a pixel
+    // distribution histogram and cutting off low outliers.
+    vector<uchar> removed(numTrueComponents + 1, 0);
 
+    for(int l = 1; l <= numTrueComponents; l++)
+        if(pxPerLabel[l] < minPx && !touchesSides(mbrMin[l], mbrMax[l], seamSides, rows, cols))
+            removed[l] = 1;
+
+    // label image and removal of the skipped components in one sweep
+    parallel_for_(Range(0, blocks.strips()), LabelImageBody(black, blocks, componentOf.data(), removed.data(), &labels, input),
+                  blocks.strips());
+
+    pipelineLog() << "Connected component analysis done." << "\n";
+    pipelineLog() << "Number of components found: " << numTrueComponents << "\n";
+
+
+    // debug: color found components
+    bool visualize = debugViewEnabled();
     Mat showMBR;
-    cvtColor(*input, showMBR, CV_GRAY2RGB);
 
-    // color found components
-    for (int i = 0; i < rows; i++)
-        for(int j = 0; j < cols; j++)
-        {
-            if(labels[i * cols + j] != 0)
+    if(visualize)
+    {
+        cvtColor(*input, showMBR, CV_GRAY2RGB);
+
+        for (int i = 0; i < rows; i++)
+            for(int j = 0; j < cols; j++)
             {
-                Vec3b color = intToRGB(Vec2i(0, numTrueComponents), labels[i * cols + j]);
-                showMBR.at<Vec3b>(i, j) = color;
+                if(labels.at<int>(i, j) != 0)
+                {
+                    Vec3b color = intToRGB(Vec2i(0, numTrueComponents), labels.at<int>(i, j));
+                    showMBR.at<Vec3b>(i, j) = color;
+                }
             }
+    }
 
-            else
-                showMBR.at<Vec3b>(i, j) = showMBR.at<Vec3b>(i, j);
-        }
 
 
+    vector<int> keptAs(numTrueComponents + 1, -1); // index of each kept component in "components"
 
     // Retrieve MBRs, store them and show them
-    for(set<int>::iterator iter = trueLabels.begin(); iter != trueLabels.end(); iter++)
+    for(int l = 1; l <= numTrueComponents; l++)
     {
-        // skip coordinates of invalid sets
-        if(!isValidCoord(MBRCoords[*iter]))
-            continue;
-
-        // Skip components which include too few
-        // black pixels. The lower limit should be one for which
-        // it is hard to imagine that any letter that is of reasonable size
-        // could be drawn with less pixels than the limit.
-        //
-        // Idea: Find minPx dynamically by constructing a pixel
-        // distribution histogram and cutting off low outliers.
-        if(pxPerLabel[*iter] < minPx)
+        // already erased by the finalize pass
+        if(removed[l])
         {
-            eraseConnectedPixels(seedPerLabel[*iter], input);
+            countStage("unionFindComponents", "erasedComponents", 1);
             continue;
         }
 
         // create connected component
         // and store it in vector
-        components->push_back(*(new ConnectedComponent((MBRCoords[*iter])[0], (MBRCoords[*iter])[1], pxPerLabel[*iter], seedPerLabel[*iter])));
-
-        // rectangle works with (col,row), so swap coordinates
-        Point min = Vec2i((MBRCoords[*iter][0])[1], (MBRCoords[*iter][0])[0]);
-        Point max = Vec2i((MBRCoords[*iter][1])[1], (MBRCoords[*iter][1])[0]);
+        keptAs[l] = components->size();
+        components->push_back(ConnectedComponent(mbrMin[l], mbrMax[l], pxPerLabel[l], seedPerLabel[l]));
+        components->back().label = l;
 
         // draw MBR for this component
-        rectangle(showMBR, min, max, Scalar(0, 0, 255), 1, 8, 0);
+        if(visualize)
+        {
+            // rectangle works with (col,row), so swap coordinates
+            Point min = Vec2i(mbrMin[l][1], mbrMin[l][0]);
+            Point max = Vec2i(mbrMax[l][1], mbrMax[l][0]);
+
+            rectangle(showMBR, min, max, Scalar(0, 0, 255), 1, 8, 0);
+        }
     }
 
-    cout << "Number of components after pixel filter with min size " << minPx << ": " << components->size() << "\n\n";
+    if(runs != NULL)
+        collectRuns(black, blocks, componentOf, keptAs, components, runs);
+
+    pipelineLog() << "Number of components after pixel filter with min size " << minPx << ": " << components->size() << "\n\n";
+
+    countStage("unionFindComponents", "pixels", (long long) rows * cols);
+    countStage("unionFindComponents", "provisionalLabels", blocks.count);
+    countStage("unionFindComponents", "components", numTrueComponents);
+    countStage("unionFindComponents", "keptComponents", components->size());
 
     // debug? set areas for components
     for(auto iter = components->begin(); iter != components->end(); iter++)
         (*iter).area = getMBRArea(*iter);
 
-    // cleanup
-    //delete [] labels;
-    delete [] seedPerLabel;
-    delete [] pxPerLabel;
-    delete [] MBRCoords;
-    delete uf;
+    // labels of removed components are kept in labelImage
+    // (their pixels are white in the input now)
 
     // show result
-    namedWindow("Components", CV_WINDOW_NORMAL);
-    imshow("Components", showMBR);
+    debugShow("Components", showMBR);
 
     //imwrite("Components.png", showMBR);
+
+    return numTrueComponents;
+}
+
+// Labels the 8-connected black pixels reachable from seed (which has
+// to be black) with "label" and returns them as a component. Pixels
+// with a label above maxOldLabel were labeled by this pass already.
+static ConnectedComponent relabelFrom (Vec2i seed, int label, int maxOldLabel, const Mat& input, Mat* labelImage,
+                                       vector<Vec2i>* pixels)
+{
+    Vec2i first = seed, mbrMin = seed, mbrMax = seed;
+
+    pixels->clear();
+    pixels->push_back(seed);
+    labelImage->at<int>(seed[0], seed[1]) = label;
+
+    // the pixel list doubles as the stack of unexpanded pixels
+    for(size_t next = 0; next < pixels->size(); next++)
+    {
+        Vec2i p = (*pixels)[next];
+
+        if(rasterBefore(p, first))
+            first = p;
+
+        mbrMin = Vec2i(min(mbrMin[0], p[0]), min(mbrMin[1], p[1]));
+        mbrMax = Vec2i(max(mbrMax[0], p[0]), max(mbrMax[1], p[1]));
+
+        for(int i = max(p[0] - 1, 0); i <= min(p[0] + 1, input.rows - 1); i++)
+            for(int j = max(p[1] - 1, 0); j <= min(p[1] + 1, input.cols - 1); j++)
+            {
+                int& l = labelImage->at<int>(i, j);
+
+                if(input.at<uchar>(i, j) == 0 && l <= maxOldLabel)
+                {
+                    l = label;
+                    pixels->push_back(Vec2i(i, j));
+                }
+            }
+    }
+
+    ConnectedComponent comp = ConnectedComponent(mbrMin, mbrMax, pixels->size(), first);
+    comp.label = label;
+    comp.area = getMBRArea(comp);
+
+    return comp;
+}
+
+// Relabels the parts of a labeled image (see unionFindComponents) that
+// changed after the labeling, e.g. because text was erased, without
+// labeling the whole image again. "modified" holds the rectangles in
+// which pixels were changed (made white or black).
+//
+// The labeled components with pixels in or next to a modified rectangle
+// are the affected ones: only they can have been split, shrunk or joined.
+// Every part of them that is left has a pixel next to a changed pixel, so
+// the black pixels in and next to the rectangles are enough as seeds. The
+// affected components are replaced by the components now formed by their
+// remaining pixels and the new black pixels, which get new labels
+// (numLabels + 1, ...); those with less than minPx pixels are erased from
+// the input instead. The work is proportional to the size of the affected
+// components, not to the image.
+//
+// "components" is expected to hold the components that "filter" kept
+// (e.g. the one of areaFilter), and so does the result: affected
+// components that were dropped by the filter are relabeled too, and new
+// components it rejects keep their label but aren't added. The kept ones
+// are appended in raster order of their first pixel, so the list has the
+// same components as after labeling the whole image again and filtering.
+// They have no runs (numRuns = 0); the runs of the other components
+// are still valid since none of their pixels changed.
+//
+// Returns the new number of labels used.
+int relabelRegions(Mat* input, Mat* labelImage, int numLabels, vector<ConnectedComponent>* components,
+                   const vector<Rect>& modified, int minPx, const ComponentFilter& filter)
+{
+    ScopedStageTimer timer("relabelRegions");
+
+    const Rect image = Rect(0, 0, input->cols, input->rows);
+    const int maxOldLabel = numLabels;
+
+    vector<bool> affected(numLabels + 1, false);
+    vector<Vec2i> seeds; // black pixels in and next to the modified rectangles
+
+    for(auto rect = modified.begin(); rect != modified.end(); rect++)
+    {
+        // one pixel more on each side: components next
+        // to a new pixel may have been joined by it
+        Rect area = Rect((*rect).x - 1, (*rect).y - 1, (*rect).width + 2, (*rect).height + 2) & image;
+
+        for(int i = area.y; i < area.y + area.height; i++)
+        {
+            int* labelRow = labelImage->ptr<int>(i);
+            const uchar* inputRow = input->ptr<uchar>(i);
+
+            for(int j = area.x; j < area.x + area.width; j++)
+            {
+                affected[labelRow[j]] = true;
+
+                // new pixels may still carry the label of a removed component,
+                // erased pixels (only inside the rectangle) lose their label
+                if(inputRow[j] == 0)
+                    seeds.push_back(Vec2i(i, j));
+                else
+                    labelRow[j] = 0;
+            }
+        }
+    }
+
+    affected[0] = false;
+
+    vector<ConnectedComponent> kept;
+
+    for(auto comp = components->begin(); comp != components->end(); comp++)
+        if(!affected[(*comp).label])
+            kept.push_back(*comp);
+
+    vector<ConnectedComponent> found;
+    vector<Vec2i> pixels;
+
+    for(auto seed = seeds.begin(); seed != seeds.end(); seed++)
+    {
+        // already reached from another seed (or erased by the pixel filter)
+        if(labelImage->at<int>((*seed)[0], (*seed)[1]) > maxOldLabel || input->at<uchar>((*seed)[0], (*seed)[1]) != 0)
+            continue;
+
+        ConnectedComponent comp = relabelFrom(*seed, numLabels + 1, maxOldLabel, *input, labelImage, &pixels);
+
+        // same pixel filter as in unionFindComponents
+        if(comp.numBlackPixels < minPx)
+        {
+            for(auto p = pixels.begin(); p != pixels.end(); p++)
+            {
+                input->at<uchar>((*p)[0], (*p)[1]) = 255;
+                labelImage->at<int>((*p)[0], (*p)[1]) = 0;
+            }
+
+            continue;
+        }
+
+        numLabels++;
+
+        if(filter(comp))
+            found.push_back(comp);
+    }
+
+    sort(found.begin(), found.end(), [](const ConnectedComponent& a, const ConnectedComponent& b) { return rasterBefore(a.seed, b.seed); });
+
+    countStage("relabelRegions", "seeds", seeds.size());
+    countStage("relabelRegions", "removedComponents", components->size() - kept.size());
+    countStage("relabelRegions", "newComponents", found.size());
+
+    kept.insert(kept.end(), found.begin(), found.end());
+    *components = kept;
+
+    return numLabels;
 }
@@ -0,0 +1,680 @@
+/**
+  * Vectorized per-pixel threshold kernels used to extract binary
+  * layers (black layer, white layer) from an image, and the
+  * compare-and-set kernel that erases a labeled component.
+  *
+  * Each row is processed with AVX2 or SSE2 where the CPU supports it
+  * and with plain C++ otherwise; the rows themselves are split into
+  * bands that are processed in parallel.
+  *
+  * Author: phugen
+  */
+
+#include "include/thresholdkernel.hpp"
+
+#include <atomic>
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HAVE_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+
+static atomic<int> maxKernelLevel(KERNEL_AVX2);
+
+static int detectKernelLevel ()
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+
+    if(__builtin_cpu_supports("sse2"))
+        return KERNEL_SSE2;
+#endif
+
+    return KERNEL_SCALAR;
+}
+
+int thresholdKernelLevel ()
+{
+    static const int supported = detectKernelLevel();
+
+    return min(supported, maxKernelLevel.load());
+}
+
+void setThresholdKernelLevel (int maxLevel)
+{
+    maxKernelLevel = maxLevel;
+}
+
+
+// ------------------------- scalar kernels ---------------------------
+
+// Writes "inside" for all pixels whose channels are all <= their
+// threshold, "outside" for all others. Returns the number of inside pixels.
+static int bgrRowScalar (const uchar* src, uchar* dst, int from, int to, Vec3b t, uchar inside, uchar outside)
+{
+    int count = 0;
+
+    for(int j = from; j < to; j++)
+    {
+        const uchar* px = src + 3 * j;
+        bool in = px[0] <= t[0] && px[1] <= t[1] && px[2] <= t[2];
+
+        dst[j] = in ? inside : outside;
+        count += in;
+    }
+
+    return count;
+}
+
+static int grayRowScalar (const uchar* src, uchar* dst, int from, int to, uchar t, uchar below, uchar above)
+{
+    int count = 0;
+
+    for(int j = from; j < to; j++)
+    {
+        bool in = src[j] <= t;
+
+        dst[j] = in ? below : above;
+        count += in;
+    }
+
+    return count;
+}
+
+// Sets dst[j] to 255 where labels[j] == label.
+static int eraseRowScalar (const int* labels, uchar* dst, int from, int to, int label)
+{
+    int count = 0;
+
+    for(int j = from; j < to; j++)
+        if(labels[j] == label)
+        {
+            dst[j] = 255;
+            count++;
+        }
+
+    return count;
+}
+
+// Writes the largest channel value of each BGR pixel.
+static void maxRowScalar (const uchar* src, uchar* dst, int from, int to)
+{
+    for(int j = from; j < to; j++)
+    {
+        const uchar* px = src + 3 * j;
+        dst[j] = max(px[0], max(px[1], px[2]));
+    }
+}
+
+
+#ifdef HAVE_X86_KERNELS
+
+// -------------------------- SSE2 kernels ----------------------------
+
+// Splits 32 interleaved BGR pixels (six registers in memory order)
+// into two registers per channel: c[0], c[1] = B, c[2], c[3] = G
+// and c[4], c[5] = R. Five rounds of byte interleaving, as every
+// round moves each byte one step closer to its channel register.
+__attribute__((target("sse2")))
+static inline void deinterleaveBGR (__m128i* c)
+{
+    for(int round = 0; round < 5; round++)
+    {
+        __m128i n0 = _mm_unpacklo_epi8(c[0], c[3]);
+        __m128i n1 = _mm_unpackhi_epi8(c[0], c[3]);
+        __m128i n2 = _mm_unpacklo_epi8(c[1], c[4]);
+        __m128i n3 = _mm_unpackhi_epi8(c[1], c[4]);
+        __m128i n4 = _mm_unpacklo_epi8(c[2], c[5]);
+        __m128i n5 = _mm_unpackhi_epi8(c[2], c[5]);
+
+        c[0] = n0; c[1] = n1; c[2] = n2; c[3] = n3; c[4] = n4; c[5] = n5;
+    }
+}
+
+// unsigned a <= b for all bytes
+__attribute__((target("sse2")))
+static inline __m128i lessEqual (__m128i a, __m128i b)
+{
+    return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i selectBytes (__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline int popcount (unsigned int bits)
+{
+    return __builtin_popcount(bits);
+}
+
+__attribute__((target("sse2")))
+static int bgrRowSSE2 (const uchar* src, uchar* dst, int cols, Vec3b t, uchar inside, uchar outside)
+{
+    const __m128i tb = _mm_set1_epi8((char) t[0]);
+    const __m128i tg = _mm_set1_epi8((char) t[1]);
+    const __m128i tr = _mm_set1_epi8((char) t[2]);
+    const __m128i vin = _mm_set1_epi8((char) inside);
+    const __m128i vout = _mm_set1_epi8((char) outside);
+
+    int count = 0;
+    int j = 0;
+
+    // 32 pixels per iteration
+    for(; j + 32 <= cols; j += 32)
+    {
+        __m128i c[6];
+
+        for(int k = 0; k < 6; k++)
+            c[k] = _mm_loadu_si128((const __m128i*) (src + 3 * j + 16 * k));
+
+        deinterleaveBGR(c);
+
+        __m128i m0 = _mm_and_si128(_mm_and_si128(lessEqual(c[0], tb), lessEqual(c[2], tg)), lessEqual(c[4], tr));
+        __m128i m1 = _mm_and_si128(_mm_and_si128(lessEqual(c[1], tb), lessEqual(c[3], tg)), lessEqual(c[5], tr));
+
+        _mm_storeu_si128((__m128i*) (dst + j), selectBytes(m0, vin, vout));
+        _mm_storeu_si128((__m128i*) (dst + j + 16), selectBytes(m1, vin, vout));
+
+        count += popcount(_mm_movemask_epi8(m0)) + popcount(_mm_movemask_epi8(m1));
+    }
+
+    return count + bgrRowScalar(src, dst, j, cols, t, inside, outside);
+}
+
+__attribute__((target("sse2")))
+static int grayRowSSE2 (const uchar* src, uchar* dst, int cols, uchar t, uchar below, uchar above)
+{
+    const __m128i vt = _mm_set1_epi8((char) t);
+    const __m128i vbelow = _mm_set1_epi8((char) below);
+    const __m128i vabove = _mm_set1_epi8((char) above);
+
+    int count = 0;
+    int j = 0;
+
+    for(; j + 16 <= cols; j += 16)
+    {
+        __m128i m = lessEqual(_mm_loadu_si128((const __m128i*) (src + j)), vt);
+
+        _mm_storeu_si128((__m128i*) (dst + j), selectBytes(m, vbelow, vabove));
+        count += popcount(_mm_movemask_epi8(m));
+    }
+
+    return count + grayRowScalar(src, dst, j, cols, t, below, above);
+}
+
+// The compare masks of 16 labels, packed to one byte per label
+// (0xff where equal), become the bits that turn the pixels white.
+__attribute__((target("sse2")))
+static int eraseRowSSE2 (const int* labels, uchar* dst, int cols, int label)
+{
+    const __m128i vl = _mm_set1_epi32(label);
+
+    int count = 0;
+    int j = 0;
+
+    for(; j + 16 <= cols; j += 16)
+    {
+        __m128i m0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (labels + j)), vl);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (labels + j + 4)), vl);
+        __m128i m2 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (labels + j + 8)), vl);
+        __m128i m3 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (labels + j + 12)), vl);
+
+        __m128i mask = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+        int bits = _mm_movemask_epi8(mask);
+
+        if(bits == 0)
+            continue;
+
+        __m128i* d = (__m128i*) (dst + j);
+        _mm_storeu_si128(d, _mm_or_si128(_mm_loadu_si128(d), mask));
+
+        count += popcount(bits);
+    }
+
+    return count + eraseRowScalar(labels, dst, j, cols, label);
+}
+
+__attribute__((target("sse2")))
+static void maxRowSSE2 (const uchar* src, uchar* dst, int cols)
+{
+    int j = 0;
+
+    for(; j + 32 <= cols; j += 32)
+    {
+        __m128i c[6];
+
+        for(int k = 0; k < 6; k++)
+            c[k] = _mm_loadu_si128((const __m128i*) (src + 3 * j + 16 * k));
+
+        deinterleaveBGR(c);
+
+        _mm_storeu_si128((__m128i*) (dst + j), _mm_max_epu8(_mm_max_epu8(c[0], c[2]), c[4]));
+        _mm_storeu_si128((__m128i*) (dst + j + 16), _mm_max_epu8(_mm_max_epu8(c[1], c[3]), c[5]));
+    }
+
+    maxRowScalar(src, dst, j, cols);
+}
+
+
+// -------------------------- AVX2 kernels ----------------------------
+
+// The byte interleaving instructions work on each 128 bit lane separately,
+// so the lanes hold two independent blocks of 32 pixels each.
+__attribute__((target("avx2")))
+static inline void deinterleaveBGR (__m256i* c)
+{
+    for(int round = 0; round < 5; round++)
+    {
+        __m256i n0 = _mm256_unpacklo_epi8(c[0], c[3]);
+        __m256i n1 = _mm256_unpackhi_epi8(c[0], c[3]);
+        __m256i n2 = _mm256_unpacklo_epi8(c[1], c[4]);
+        __m256i n3 = _mm256_unpackhi_epi8(c[1], c[4]);
+        __m256i n4 = _mm256_unpacklo_epi8(c[2], c[5]);
+        __m256i n5 = _mm256_unpackhi_epi8(c[2], c[5]);
+
+        c[0] = n0; c[1] = n1; c[2] = n2; c[3] = n3; c[4] = n4; c[5] = n5;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lessEqual (__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+}
+
+__attribute__((target("avx2")))
+static int bgrRowAVX2 (const uchar* src, uchar* dst, int cols, Vec3b t, uchar inside, uchar outside)
+{
+    const __m256i tb = _mm256_set1_epi8((char) t[0]);
+    const __m256i tg = _mm256_set1_epi8((char) t[1]);
+    const __m256i tr = _mm256_set1_epi8((char) t[2]);
+    const __m256i vin = _mm256_set1_epi8((char) inside);
+    const __m256i vout = _mm256_set1_epi8((char) outside);
+
+    int count = 0;
+    int j = 0;
+
+    // 64 pixels per iteration: pixels j .. j+31 in the lower lanes,
+    // pixels j+32 .. j+63 in the upper lanes
+    for(; j + 64 <= cols; j += 64)
+    {
+        const uchar* lower = src + 3 * j;
+        const uchar* upper = lower + 96;
+        __m256i c[6];
+
+        for(int k = 0; k < 6; k++)
+            c[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (lower + 16 * k))),
+                                           _mm_loadu_si128((const __m128i*) (upper + 16 * k)), 1);
+
+        deinterleaveBGR(c);
+
+        __m256i m0 = _mm256_and_si256(_mm256_and_si256(lessEqual(c[0], tb), lessEqual(c[2], tg)), lessEqual(c[4], tr));
+        __m256i m1 = _mm256_and_si256(_mm256_and_si256(lessEqual(c[1], tb), lessEqual(c[3], tg)), lessEqual(c[5], tr));
+
+        __m256i r0 = _mm256_blendv_epi8(vout, vin, m0);
+        __m256i r1 = _mm256_blendv_epi8(vout, vin, m1);
+
+        // gather the lanes back into pixel order
+        _mm256_storeu_si256((__m256i*) (dst + j), _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256((__m256i*) (dst + j + 32), _mm256_permute2x128_si256(r0, r1, 0x31));
+
+        count += popcount(_mm256_movemask_epi8(m0)) + popcount(_mm256_movemask_epi8(m1));
+    }
+
+    return count + bgrRowSSE2(src + 3 * j, dst + j, cols - j, t, inside, outside);
+}
+
+__attribute__((target("avx2")))
+static int grayRowAVX2 (const uchar* src, uchar* dst, int cols, uchar t, uchar below, uchar above)
+{
+    const __m256i vt = _mm256_set1_epi8((char) t);
+    const __m256i vbelow = _mm256_set1_epi8((char) below);
+    const __m256i vabove = _mm256_set1_epi8((char) above);
+
+    int count = 0;
+    int j = 0;
+
+    for(; j + 32 <= cols; j += 32)
+    {
+        __m256i m = lessEqual(_mm256_loadu_si256((const __m256i*) (src + j)), vt);
+
+        _mm256_storeu_si256((__m256i*) (dst + j), _mm256_blendv_epi8(vabove, vbelow, m));
+        count += popcount(_mm256_movemask_epi8(m));
+    }
+
+    return count + grayRowSSE2(src + j, dst + j, cols - j, t, below, above);
+}
+
+__attribute__((target("avx2")))
+static int eraseRowAVX2 (const int* labels, uchar* dst, int cols, int label)
+{
+    const __m256i vl = _mm256_set1_epi32(label);
+
+    // packs works per 128 bit lane: put the 4-byte groups back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    int count = 0;
+    int j = 0;
+
+    for(; j + 32 <= cols; j += 32)
+    {
+        __m256i m0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (labels + j)), vl);
+        __m256i m1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (labels + j + 8)), vl);
+        __m256i m2 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (labels + j + 16)), vl);
+        __m256i m3 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (labels + j + 24)), vl);
+
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(m0, m1), _mm256_packs_epi32(m2, m3));
+        int bits = _mm256_movemask_epi8(packed);
+
+        if(bits == 0)
+            continue;
+
+        __m256i mask = _mm256_permutevar8x32_epi32(packed, order);
+        __m256i* d = (__m256i*) (dst + j);
+        _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), mask));
+
+        count += popcount(bits);
+    }
+
+    return count + eraseRowSSE2(labels + j, dst + j, cols - j, label);
+}
+
+__attribute__((target("avx2")))
+static void maxRowAVX2 (const uchar* src, uchar* dst, int cols)
+{
+    int j = 0;
+
+    for(; j + 64 <= cols; j += 64)
+    {
+        const uchar* lower = src + 3 * j;
+        const uchar* upper = lower + 96;
+        __m256i c[6];
+
+        for(int k = 0; k < 6; k++)
+            c[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (lower + 16 * k))),
+                                           _mm_loadu_si128((const __m128i*) (upper + 16 * k)), 1);
+
+        deinterleaveBGR(c);
+
+        __m256i m0 = _mm256_max_epu8(_mm256_max_epu8(c[0], c[2]), c[4]);
+        __m256i m1 = _mm256_max_epu8(_mm256_max_epu8(c[1], c[3]), c[5]);
+
+        _mm256_storeu_si256((__m256i*) (dst + j), _mm256_permute2x128_si256(m0, m1, 0x20));
+        _mm256_storeu_si256((__m256i*) (dst + j + 32), _mm256_permute2x128_si256(m0, m1, 0x31));
+    }
+
+    maxRowSSE2(src + 3 * j, dst + j, cols - j);
+}
+
+#endif // HAVE_X86_KERNELS
+
+
+// ------------------------- row band drivers -------------------------
+
+class BGRThresholdBody : public ParallelLoopBody
+{
+public:
+    BGRThresholdBody(const Mat& input, Mat* output, Vec3b t, uchar inside, uchar outside, atomic<long long>* count)
+        : input(input), output(output), t(t), inside(inside), outside(outside), count(count), level(thresholdKernelLevel())
+    {}
+
+    void operator() (const Range& rows) const
+    {
+        long long bandCount = 0;
+
+        for(int i = rows.start; i < rows.end; i++)
+        {
+            const uchar* src = input.ptr<uchar>(i);
+            uchar* dst = output->ptr<uchar>(i);
+
+#ifdef HAVE_X86_KERNELS
+            if(level == KERNEL_AVX2)
+                bandCount += bgrRowAVX2(src, dst, input.cols, t, inside, outside);
+            else if(level == KERNEL_SSE2)
+                bandCount += bgrRowSSE2(src, dst, input.cols, t, inside, outside);
+            else
+#endif
+                bandCount += bgrRowScalar(src, dst, 0, input.cols, t, inside, outside);
+        }
+
+        *count += bandCount;
+    }
+
+private:
+    const Mat& input;
+    Mat* output;
+    Vec3b t;
+    uchar inside, outside;
+    atomic<long long>* count;
+    int level;
+};
+
+class GrayThresholdBody : public ParallelLoopBody
+{
+public:
+    GrayThresholdBody(const Mat& input, Mat* output, uchar t, uchar below, uchar above, atomic<long long>* count)
+        : input(input), output(output), t(t), below(below), above(above), count(count), level(thresholdKernelLevel())
+    {}
+
+    void operator() (const Range& rows) const
+    {
+        long long bandCount = 0;
+
+        for(int i = rows.start; i < rows.end; i++)
+        {
+            const uchar* src = input.ptr<uchar>(i);
+            uchar* dst = output->ptr<uchar>(i);
+
+#ifdef HAVE_X86_KERNELS
+            if(level == KERNEL_AVX2)
+                bandCount += grayRowAVX2(src, dst, input.cols, t, below, above);
+            else if(level == KERNEL_SSE2)
+                bandCount += grayRowSSE2(src, dst, input.cols, t, below, above);
+            else
+#endif
+                bandCount += grayRowScalar(src, dst, 0, input.cols, t, below, above);
+        }
+
+        *count += bandCount;
+    }
+
+private:
+    const Mat& input;
+    Mat* output;
+    uchar t;
+    uchar below, above;
+    atomic<long long>* count;
+    int level;
+};
+
+class ChannelMaximumBody : public ParallelLoopBody
+{
+public:
+    ChannelMaximumBody(const Mat& input, Mat* output, long long* histogram, mutex* histogramMutex)
+        : input(input), output(output), histogram(histogram), histogramMutex(histogramMutex), level(thresholdKernelLevel())
+    {}
+
+    void operator() (const Range& rows) const
+    {
+        long long bandHistogram[256] = { 0 };
+
+        for(int i = rows.start; i < rows.end; i++)
+        {
+            const uchar* src = input.ptr<uchar>(i);
+            uchar* dst = output->ptr<uchar>(i);
+
+#ifdef HAVE_X86_KERNELS
+            if(level == KERNEL_AVX2)
+                maxRowAVX2(src, dst, input.cols);
+            else if(level == KERNEL_SSE2)
+                maxRowSSE2(src, dst, input.cols);
+            else
+#endif
+                maxRowScalar(src, dst, 0, input.cols);
+
+            // the row is still in the cache
+            if(histogram != NULL)
+                for(int j = 0; j < input.cols; j++)
+                    bandHistogram[dst[j]]++;
+        }
+
+        if(histogram != NULL)
+        {
+            lock_guard<mutex> lock(*histogramMutex);
+
+            for(int v = 0; v < 256; v++)
+                histogram[v] += bandHistogram[v];
+        }
+    }
+
+private:
+    const Mat& input;
+    Mat* output;
+    long long* histogram;
+    mutex* histogramMutex;
+    int level;
+};
+
+// Number of row bands for an image; bands of roughly
+// 256 KB keep the scheduling overhead negligible.
+static double numBands (const Mat& input)
+{
+    return max(1., (double) input.rows * input.cols * input.elemSize() / (256 * 1024));
+}
+
+// Binarizes a BGR image (CV_8UC3): pixels with all channels <= their
+// threshold become "inside", all others "outside". Output is a CV_8U
+// image of the same size (allocated if necessary).
+// Returns the number of inside pixels.
+long long thresholdBGR (const Mat& input, Vec3b thresholds, uchar inside, uchar outside, Mat* output)
+{
+    CV_Assert(input.type() == CV_8UC3);
+
+    output->create(input.rows, input.cols, CV_8U);
+
+    atomic<long long> count(0);
+    parallel_for_(Range(0, input.rows), BGRThresholdBody(input, output, thresholds, inside, outside, &count), numBands(input));
+
+    return count;
+}
+
+// Writes the largest channel value of each pixel of a BGR image to
+// a CV_8U image. A pixel is below the threshold t in all channels
+// exactly if this value is <= t. If histogram isn't NULL, the values
+// are also added to it (256 bins) in the same pass.
+void channelMaximum (const Mat& input, Mat* output, long long* histogram)
+{
+    CV_Assert(input.type() == CV_8UC3);
+
+    output->create(input.rows, input.cols, CV_8U);
+
+    mutex histogramMutex;
+    parallel_for_(Range(0, input.rows), ChannelMaximumBody(input, output, histogram, &histogramMutex), numBands(input));
+}
+
+// Threshold that separates a histogram into a dark (<= threshold)
+// and a bright class with the largest between-class variance (Otsu).
+int otsuThreshold (const long long* histogram)
+{
+    long long total = 0;
+    double sum = 0.;
+
+    for(int v = 0; v < 256; v++)
+    {
+        total += histogram[v];
+        sum += (double) v * histogram[v];
+    }
+
+    long long dark = 0;
+    double darkSum = 0.;
+    double bestVariance = -1.;
+    int best = 0;
+
+    for(int t = 0; t < 255; t++)
+    {
+        dark += histogram[t];
+        darkSum += (double) t * histogram[t];
+
+        long long bright = total - dark;
+
+        if(dark == 0 || bright == 0)
+            continue;
+
+        double darkMean = darkSum / dark;
+        double brightMean = (sum - darkSum) / bright;
+        double variance = (double) dark * bright * (darkMean - brightMean) * (darkMean - brightMean);
+
+        if(variance > bestVariance)
+        {
+            bestVariance = variance;
+            best = t;
+        }
+    }
+
+    return best;
+}
+
+// Binarizes a grayscale image (CV_8U): pixels <= threshold become "below",
+// all others "above". Output may be the input itself.
+// Returns the number of below pixels.
+long long thresholdGray (const Mat& input, int threshold, uchar below, uchar above, Mat* output)
+{
+    CV_Assert(input.type() == CV_8U);
+
+    output->create(input.rows, input.cols, CV_8U);
+
+    // thresholds outside the value range
+    if(threshold < 0)
+    {
+        output->setTo(Scalar(above));
+        return 0;
+    }
+
+    threshold = min(threshold, 255);
+
+    atomic<long long> count(0);
+    parallel_for_(Range(0, input.rows), GrayThresholdBody(input, output, (uchar) threshold, below, above, &count), numBands(input));
+
+    return count;
+}
+
+// Compare-and-set over a rectangle: sets all pixels of image (CV_8U)
+// inside area whose label (CV_32S, same size) is "label" to 255.
+// With the label image of a labeling, this erases a component in
+// one sweep over its MBR. Returns the number of erased pixels.
+long long eraseLabel (const Mat& labels, int label, Rect area, Mat* image)
+{
+    CV_Assert(labels.type() == CV_32S && image->type() == CV_8U && labels.size() == image->size());
+
+    area &= Rect(0, 0, image->cols, image->rows);
+
+    const int level = thresholdKernelLevel();
+    long long count = 0;
+
+    for(int i = area.y; i < area.y + area.height; i++)
+    {
+        const int* src = labels.ptr<int>(i) + area.x;
+        uchar* dst = image->ptr<uchar>(i) + area.x;
+
+#ifdef HAVE_X86_KERNELS
+        if(level == KERNEL_AVX2)
+            count += eraseRowAVX2(src, dst, area.width, label);
+        else if(level == KERNEL_SSE2)
+            count += eraseRowSSE2(src, dst, area.width, label);
+        else
+#endif
+            count += eraseRowScalar(src, dst, 0, area.width, label);
+    }
+
+    return count;
+}
@@ -0,0 +1,487 @@
+/**
+  * Tiled execution of the pipeline for scans that are too large
+  * to be processed in one piece.
+  *
+  * The connected component analysis runs on one tile at a time;
+  * components that cross a tile seam are reconciled afterwards.
+  * Text removal groups the components of the whole sheet, which
+  * needs no per-pixel data, and erases the characters in place.
+  * Vectorization runs on overlapping tiles, and paths that end at
+  * a seam are stitched to their continuation in the neighboring
+  * tile. The per-pixel working data of these stages (labels,
+  * thinning buffers) is thus bounded by the tile size; only the
+  * black layer itself (one byte per pixel) is kept for the whole
+  * sheet.
+  *
+  * Author: phugen
+  */
+
+#include "include/tiling.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/text_segmentation/auxiliary.hpp"
+#include "include/text_segmentation/unionfind.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/collineargrouping.hpp"
+#include "include/vectorization/vectorize.hpp"
+#include "include/vectorization/douglaspeucker.h"
+#include "include/pipelinelog.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+using namespace std;
+using namespace cv;
+
+
+// Splits a sheet into a grid of non-overlapping tiles
+// of (at most) tileSize x tileSize pixels, row by row.
+vector<Rect> tileGrid (Size sheet, int tileSize)
+{
+    vector<Rect> tiles;
+
+    for(int y = 0; y < sheet.height; y += tileSize)
+        for(int x = 0; x < sheet.width; x += tileSize)
+            tiles.push_back(Rect(x, y, min(tileSize, sheet.width - x), min(tileSize, sheet.height - y)));
+
+    return tiles;
+}
+
+// Returns the sides of a tile that border other tiles.
+static int seamSidesOf (Rect tile, Size sheet)
+{
+    int sides = 0;
+
+    if(tile.y > 0) sides |= SIDE_TOP;
+    if(tile.y + tile.height < sheet.height) sides |= SIDE_BOTTOM;
+    if(tile.x > 0) sides |= SIDE_LEFT;
+    if(tile.x + tile.width < sheet.width) sides |= SIDE_RIGHT;
+
+    return sides;
+}
+
+// True if pixel a comes before pixel b in raster order (row first).
+static inline bool rasterBefore (Vec2i a, Vec2i b)
+{
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
+
+// Order components by their first pixel, like unionFindComponents
+// does, so the result doesn't depend on the tile size and the
+// stages after the labeling see the same list as on the whole sheet.
+static bool compareBySeed (const ConnectedComponent& a, const ConnectedComponent& b)
+{
+    return rasterBefore(a.seed, b.seed);
+}
+
+// Connected component analysis of the black layer, one tile at a time.
+//
+// Components that lie inside a tile are final after the tile has been
+// labeled. Components touching a seam are only pieces; the pieces on
+// both sides of each seam are merged if any of their pixels are
+// eight-connected across the seam. The pixel filter (minPx) is applied
+// to the merged components.
+void tiledComponents (Mat* blacklayer, vector<ConnectedComponent>* components, int minPx, int tileSize)
+{
+    Size sheet = blacklayer->size();
+    vector<Rect> tiles = tileGrid(sheet, tileSize);
+
+    vector<ConnectedComponent> pieces; // components that touch a seam
+
+    // index of the piece each pixel next to a seam
+    // belongs to (-1 = background)
+    map<int, vector<int>> seamRows; // sheet row -> piece per column
+    map<int, vector<int>> seamCols; // sheet column -> piece per row
+
+    for(auto tile = tiles.begin(); tile != tiles.end(); tile++)
+    {
+        Rect t = *tile;
+        Vec2i offset = Vec2i(t.y, t.x);
+        int sides = seamSidesOf(t, sheet);
+
+        // the tile is a view into the black layer,
+        // so the pixel filter erases on the sheet
+        Mat tileBlack = (*blacklayer)(t);
+        Mat labels;
+        vector<ConnectedComponent> tileComps;
+
+        unionFindComponents(&tileBlack, &tileComps, minPx, sides, &labels);
+
+        map<int, int> pieceOfLabel;
+
+        for(auto comp = tileComps.begin(); comp != tileComps.end(); comp++)
+        {
+            ConnectedComponent c = *comp;
+            bool isPiece = touchesSides(c.mbr_min, c.mbr_max, sides, t.height, t.width);
+
+            // translate to sheet coordinates; tile
+            // labels have no meaning on the sheet
+            c.mbr_min += offset;
+            c.mbr_max += offset;
+            c.centroid += offset;
+            c.seed += offset;
+            c.label = 0;
+
+            if(isPiece)
+            {
+                pieceOfLabel[(*comp).label] = pieces.size();
+                pieces.push_back(c);
+            }
+
+            else
+                components->push_back(c);
+        }
+
+        // remember which piece the pixels along each seam belong to
+        for(int side = SIDE_TOP; side <= SIDE_RIGHT; side <<= 1)
+        {
+            if(!(sides & side))
+                continue;
+
+            bool horizontal = (side == SIDE_TOP || side == SIDE_BOTTOM);
+            int length = horizontal ? t.width : t.height;
+            vector<int>* seam;
+
+            if(side == SIDE_TOP) seam = &seamRows[t.y];
+            else if(side == SIDE_BOTTOM) seam = &seamRows[t.y + t.height - 1];
+            else if(side == SIDE_LEFT) seam = &seamCols[t.x];
+            else seam = &seamCols[t.x + t.width - 1];
+
+            if(seam->empty())
+                seam->assign(horizontal ? sheet.width : sheet.height, -1);
+
+            for(int k = 0; k < length; k++)
+            {
+                int i = horizontal ? (side == SIDE_TOP ? 0 : t.height - 1) : k;
+                int j = horizontal ? k : (side == SIDE_LEFT ? 0 : t.width - 1);
+
+                if(tileBlack.at<uchar>(i, j) != 0)
+                    continue;
+
+                auto piece = pieceOfLabel.find(labels.at<int>(i, j));
+
+                if(piece != pieceOfLabel.end())
+                    (*seam)[horizontal ? t.x + k : t.y + k] = (*piece).second;
+            }
+        }
+    }
+
+    ScopedStageTimer timer("seamMerge");
+
+    // merge pieces that are eight-connected across a seam
+    UnionFind uf(pieces.size());
+
+    for(int y = tileSize; y < sheet.height; y += tileSize)
+    {
+        vector<int>& above = seamRows[y - 1];
+        vector<int>& below = seamRows[y];
+
+        for(int x = 0; x < sheet.width; x++)
+            for(int dx = -1; dx <= 1 && above[x] >= 0; dx++)
+                if(x + dx >= 0 && x + dx < sheet.width && below[x + dx] >= 0)
+                    uf.merge(above[x], below[x + dx]);
+    }
+
+    for(int x = tileSize; x < sheet.width; x += tileSize)
+    {
+        vector<int>& left = seamCols[x - 1];
+        vector<int>& right = seamCols[x];
+
+        for(int y = 0; y < sheet.height; y++)
+            for(int dy = -1; dy <= 1 && left[y] >= 0; dy++)
+                if(y + dy >= 0 && y + dy < sheet.height && right[y + dy] >= 0)
+                    uf.merge(left[y], right[y + dy]);
+    }
+
+    // combine the MBRs and pixel counts of all pieces of a component
+    map<int, int> mergedOfRoot;
+    vector<ConnectedComponent> merged;
+
+    for(int p = 0; p < (int) pieces.size(); p++)
+    {
+        int root = uf.find(p);
+        auto m = mergedOfRoot.find(root);
+
+        if(m == mergedOfRoot.end())
+        {
+            mergedOfRoot[root] = merged.size();
+            merged.push_back(pieces[p]);
+            continue;
+        }
+
+        ConnectedComponent& c = merged[(*m).second];
+
+        c.mbr_min = Vec2i(min(c.mbr_min[0], pieces[p].mbr_min[0]), min(c.mbr_min[1], pieces[p].mbr_min[1]));
+        c.mbr_max = Vec2i(max(c.mbr_max[0], pieces[p].mbr_max[0]), max(c.mbr_max[1], pieces[p].mbr_max[1]));
+        c.numBlackPixels += pieces[p].numBlackPixels;
+
+        // the seed of a piece is its first pixel in the tile
+        if(rasterBefore(pieces[p].seed, c.seed))
+            c.seed = pieces[p].seed;
+    }
+
+    for(auto comp = merged.begin(); comp != merged.end(); comp++)
+    {
+        ConnectedComponent c = ConnectedComponent((*comp).mbr_min, (*comp).mbr_max, (*comp).numBlackPixels, (*comp).seed);
+
+        // same pixel filter as in unionFindComponents
+        if(c.numBlackPixels < minPx)
+        {
+            eraseConnectedPixels(c.seed, blacklayer);
+            continue;
+        }
+
+        c.area = getMBRArea(c);
+        components->push_back(c);
+    }
+
+    sort(components->begin(), components->end(), compareBySeed);
+
+    countStage("seamMerge", "pieces", pieces.size());
+    countStage("seamMerge", "mergedComponents", merged.size());
+    countStage("seamMerge", "components", components->size());
+}
+
+
+// Text removal (collinear grouping) for the components of a tiled sheet.
+//
+// The grouping only needs the geometry of the components, so it is done
+// for all components of the sheet at once and strings across seams are
+// found just like on the whole sheet. The characters are then erased
+// from the black layer in place, each by a flood fill from its seed;
+// no copy of the sheet or label image is needed.
+void tiledTextRemoval (Mat* blacklayer, const vector<ConnectedComponent>& components)
+{
+    ScopedStageTimer timer("collinearGrouping");
+
+    vector<int> text;
+    findTextComponents(*blacklayer, components, &text);
+
+    ScopedStageTimer eraseTimer("collinearGrouping/erase");
+
+    for(auto id = text.begin(); id != text.end(); id++)
+        eraseComponentPixels(components[*id], blacklayer);
+
+    countStage("tiledTextRemoval", "textComponents", text.size());
+}
+
+// Runs Douglas-Peucker on a path again, e.g. after two
+// paths were joined. The widths of kept nodes are kept.
+static void simplifyPath (VectorPath* path, double epsilon)
+{
+    vector<pixel> nodes;
+    vector<pixel*> nodePointers;
+
+    for(auto n = path->nodes.begin(); n != path->nodes.end(); n++)
+        nodes.push_back(pixel(*n, NULL, false));
+
+    for(auto n = nodes.begin(); n != nodes.end(); n++)
+        nodePointers.push_back(&(*n));
+
+    vector<pixel*> simplified = douglasPeucker(nodePointers, epsilon);
+
+    VectorPath result;
+
+    for(auto n = simplified.begin(); n != simplified.end(); n++)
+    {
+        int index = *n - &nodes[0];
+
+        result.nodes.push_back(path->nodes.at(index));
+        result.widths.push_back(path->widths.at(index));
+    }
+
+    *path = result;
+}
+
+// Checks if a node lies on the outermost pixels of a tile.
+static bool onTileBorder (Vec2i node, Rect tile)
+{
+    return node[0] == tile.y || node[0] == tile.y + tile.height - 1 ||
+           node[1] == tile.x || node[1] == tile.x + tile.width - 1;
+}
+
+// Joins paths of different tiles whose end nodes are eight-connected
+// across a seam into continuous paths. Joined paths are simplified
+// again so the seam doesn't leave superfluous nodes behind.
+static void stitchPaths (vector<VectorPath>* paths, const vector<int>& tileOf, const vector<Rect>& tiles, double epsilon)
+{
+    int numPaths = paths->size();
+
+    // find end nodes by position: (row, col) -> (path, end)
+    // where end 0 is the first and end 1 is the last node
+    unordered_multimap<long long, pair<int, int>> ends;
+
+    auto key = [](Vec2i node) { return ((long long) node[0] << 32) | (unsigned int) node[1]; };
+
+    for(int p = 0; p < numPaths; p++)
+    {
+        VectorPath& path = paths->at(p);
+
+        if(path.nodes.empty())
+            continue;
+
+        if(onTileBorder(path.nodes.front(), tiles[tileOf[p]]))
+            ends.insert(make_pair(key(path.nodes.front()), make_pair(p, 0)));
+
+        if(onTileBorder(path.nodes.back(), tiles[tileOf[p]]))
+            ends.insert(make_pair(key(path.nodes.back()), make_pair(p, 1)));
+    }
+
+    // link each end to at most one end in a neighboring tile
+    vector<pair<int, int>> link(2 * numPaths, make_pair(-1, -1));
+
+    for(int p = 0; p < numPaths; p++)
+        for(int e = 0; e < 2; e++)
+        {
+            VectorPath& path = paths->at(p);
+
+            if(path.nodes.empty() || link[2 * p + e].first != -1)
+                continue;
+
+            Vec2i node = (e == 0) ? path.nodes.front() : path.nodes.back();
+            Rect tile = tiles[tileOf[p]];
+
+            if(!onTileBorder(node, tile))
+                continue;
+
+            for(int di = -1; di <= 1 && link[2 * p + e].first == -1; di++)
+                for(int dj = -1; dj <= 1 && link[2 * p + e].first == -1; dj++)
+                {
+                    Vec2i neighbor = node + Vec2i(di, dj);
+
+                    // only look across the seam
+                    if(tile.contains(Point(neighbor[1], neighbor[0])))
+                        continue;
+
+                    auto candidates = ends.equal_range(key(neighbor));
+
+                    for(auto c = candidates.first; c != candidates.second; c++)
+                    {
+                        int q = (*c).second.first;
+                        int f = (*c).second.second;
+
+                        if(link[2 * q + f].first == -1)
+                        {
+                            link[2 * p + e] = make_pair(q, f);
+                            link[2 * q + f] = make_pair(p, e);
+                            break;
+                        }
+                    }
+                }
+        }
+
+    // walk the chains of linked paths; chains with an open end
+    // first, so that closed loops are all that remains afterwards
+    vector<VectorPath> stitched;
+    vector<bool> used(numPaths, false);
+    int joins = 0;
+
+    for(int pass = 0; pass < 2; pass++)
+        for(int p = 0; p < numPaths; p++)
+        {
+            if(used[p])
+                continue;
+
+            int from; // end at which the chain enters the current path
+
+            if(link[2 * p].first == -1) from = 0;
+            else if(link[2 * p + 1].first == -1) from = 1;
+            else if(pass == 1) from = 0;
+            else continue;
+
+            VectorPath chain;
+            int current = p;
+            int joined = 0;
+
+            while(current != -1 && !used[current])
+            {
+                VectorPath& path = paths->at(current);
+                used[current] = true;
+
+                if(from == 0)
+                {
+                    chain.nodes.insert(chain.nodes.end(), path.nodes.begin(), path.nodes.end());
+                    chain.widths.insert(chain.widths.end(), path.widths.begin(), path.widths.end());
+                }
+
+                else
+                {
+                    chain.nodes.insert(chain.nodes.end(), path.nodes.rbegin(), path.nodes.rend());
+                    chain.widths.insert(chain.widths.end(), path.widths.rbegin(), path.widths.rend());
+                }
+
+                pair<int, int> next = link[2 * current + (1 - from)];
+                current = next.first;
+                from = next.second;
+
+                if(current != -1 && !used[current])
+                    joined++;
+            }
+
+            if(joined > 0)
+                simplifyPath(&chain, epsilon);
+
+            joins += joined;
+            stitched.push_back(chain);
+        }
+
+    *paths = stitched;
+
+    countStage("seamStitch", "pathsIn", numPaths);
+    countStage("seamStitch", "joins", joins);
+    countStage("seamStitch", "pathsOut", paths->size());
+}
+
+// Vectorizes the black layer one tile at a time and writes the
+// result to "filename.svg".
+//
+// Each tile is thinned together with an overlap of "overlap" pixels
+// on every side, so the skeleton near the seams is the same as on
+// the full sheet; only the vectors inside the tile itself are kept.
+// The overlap should exceed the widest line, and 10px (the window
+// of the local line width estimation) at least.
+void tiledVectorize (Mat* blacklayer, string filename, double epsilon, int tileSize, int overlap)
+{
+    pipelineLog() << "\n ------------------------- \n";
+    pipelineLog() << "Starting tiled vectorization ...\n";
+
+    Size sheet = blacklayer->size();
+    vector<Rect> tiles = tileGrid(sheet, tileSize);
+
+    vector<VectorPath> paths;
+    vector<int> tileOf; // tile index of each path
+
+    for(int t = 0; t < (int) tiles.size(); t++)
+    {
+        Rect tile = tiles[t];
+        Rect padded = Rect(tile.x - overlap, tile.y - overlap, tile.width + 2 * overlap, tile.height + 2 * overlap) & Rect(0, 0, sheet.width, sheet.height);
+        Rect core = Rect(tile.x - padded.x, tile.y - padded.y, tile.width, tile.height);
+
+        pipelineLog() << "Tile " << (t + 1) << " of " << tiles.size() << "\n";
+
+        Mat paddedBlack = (*blacklayer)(padded);
+        vector<VectorPath> tilePaths = vectorizeRegion(&paddedBlack, core, epsilon);
+
+        // translate to sheet coordinates
+        for(auto path = tilePaths.begin(); path != tilePaths.end(); path++)
+        {
+            for(auto n = (*path).nodes.begin(); n != (*path).nodes.end(); n++)
+                *n += Vec2i(padded.y, padded.x);
+
+            paths.push_back(*path);
+            tileOf.push_back(t);
+        }
+    }
+
+    {
+        ScopedStageTimer timer("seamStitch");
+        stitchPaths(&paths, tileOf, tiles, epsilon);
+    }
+
+    // write vector lines to file
+    pipelineLog() << "Writing vector data to file << " << filename << ".svg...\n";
+    vectorsToFile(paths, vector<colorPoly>(), sheet, filename);
+
+    pipelineLog() << "VECTORIZATION DONE!\n";
+}
@@ -7,6 +7,8 @@
 
 #include "include/vectorization/iterative_linematching.hpp"
 #include "include/vectorization/zhangsuen.hpp"
+#include "include/debugview.hpp"
+#include "include/thresholdkernel.hpp"
 
 #include <math.h>
 #include <stack>
@@ -24,27 +26,10 @@ void negateBlackLayer(int threshold, Mat* input, Mat* output)
 {
     if (input->channels() > 1)return;
 
-    for (int i = 0; i < input->rows; i++)
-    {
-        for (int j = 0; j < input->cols; j++)
-        {
-            uchar currentPixel = input->at<uchar>(i,j);
-
-            // check thresholds (Vec3b is BGR!)
-            if (currentPixel <= threshold)
-            {
-                // pixel below all thresholds: make it white
-                output->at<uchar>(i,j) = 255;
-            }
-
-            // else: make pixel black
-            else
-                output->at<uchar>(i,j) = 0;
-        }
-    }
+    // pixels below the threshold become white, all others black
+    thresholdGray(*input, threshold, 255, 0, output);
 
-    namedWindow("negative black layer", WINDOW_AUTOSIZE);
-    imshow("negative black layer", *output);
+    debugShow("negative black layer", *output, WINDOW_AUTOSIZE);
 }
 
 /**
@@ -58,25 +43,10 @@ void getWhiteLayer(int threshold, cv::Mat* input, cv::Mat* output){
 
     if (input->channels() > 1)return;
 
-    for (int i = 0; i < input->rows; i++)
-    {
-        for (int j = 0; j < input->cols; j++)
-        {
-            uchar currentPixel = input->at<uchar>(i, j);
-            // check thresholds (Vec3b is BGR!)
-            if (currentPixel >= threshold)
-            {
-                // pixel above all thresholds: make it white
-                output->at<uchar>(i, j) = 255;
-            }
-            // else: make pixel black
-            else
-                output->at<uchar>(i, j) = 0;
-        }
-    }
+    // pixels at or above the threshold become white, all others black
+    thresholdGray(*input, threshold - 1, 0, 255, output);
 
-    namedWindow("white layer", WINDOW_AUTOSIZE);
-    imshow("white layer", *output);
+    debugShow("white layer", *output, WINDOW_AUTOSIZE);
 
 }
 
@@ -524,11 +494,11 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
     extendAllLines(blacklayer, &lines, 0.1);
     //edgeAlignment(&lines, 5, blacklayer->cols, blacklayer->rows);
     drawLineCollection(&cMat, lines, 1, Scalar(0, 0, 255));
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     cv::cvtColor(cMat, gMat, CV_BGR2GRAY);
     getWhiteLayer(250, &gMat, &gMat);
     cv::cvtColor(gMat, cMat, CV_GRAY2BGR);
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     appendLineCollection(dirLineCollection, &lines, true);
 
     //2.ITERATION=======================================================
@@ -536,11 +506,11 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
     extendAllLines(&gMat, &lines, 0.1);
     //edgeAlignment(&lines, 2, blacklayer->cols, blacklayer->rows);
     drawLineCollection(&cMat, lines, 1, Scalar(0, 255, 255));
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     cv::cvtColor(cMat, gMat, CV_BGR2GRAY);
     getWhiteLayer(250, &gMat, &gMat);
     cv::cvtColor(gMat, cMat, CV_GRAY2BGR);
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     appendLineCollection(dirLineCollection, &lines, true);
 
     //3. ITERATION========================================================
@@ -548,11 +518,11 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
     extendAllLines(&gMat, &lines, 0.1);
     //edgeAlignment(&lines, 5, blacklayer->cols, blacklayer->rows);
     drawLineCollection(&cMat, lines, 1, Scalar(0, 255, 255));
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     cv::cvtColor(cMat, gMat, CV_BGR2GRAY);
     getWhiteLayer(250, &gMat, &gMat);
     cv::cvtColor(gMat, cMat, CV_GRAY2BGR);
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     appendLineCollection(dirLineCollection, &lines, true);
 
     Mat old, diff;
@@ -580,7 +550,7 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
     extendAllLines(blacklayer, dirLineCollection, 0.1);
     drawLineCollection(&cMat, *dirLineCollection, 1, Scalar(0, 0, 255));
     edgeAlignment(dirLineCollection, 2, blacklayer->cols, blacklayer->rows);
-    if (debug){ cv::imshow(source_window, cMat); cv::waitKey(0); }
+    if (debug){ debugShow(source_window, cMat, WINDOW_AUTOSIZE); debugWait(); }
     cv::cvtColor(cMat, gMat, CV_BGR2GRAY);
     getWhiteLayer(250, &gMat, &gMat);
     cv::cvtColor(gMat, cMat, CV_GRAY2BGR);
@@ -607,7 +577,7 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
     //DRAW LINE COLLECTION====================================================
 
     drawLineCollection(&cMat, *dirLineCollection, 1, Scalar(0, 255, 255));
-    cv::imshow(source_window, cMat);
+    debugShow(source_window, cMat, WINDOW_AUTOSIZE);
     //cv::waitKey(0);
 
     if (debug){
@@ -615,8 +585,8 @@ void getFinalLines(cv::Mat* blacklayer, std::vector<cv::Vec4i>* dirLineCollectio
         getWhiteLayer(250, &gMat, &gMat);
         cv::cvtColor(gMat, cMat, CV_GRAY2BGR);
 
-        cv::imshow(source_window, cMat);
-        cv::waitKey(0);
+        debugShow(source_window, cMat, WINDOW_AUTOSIZE);
+        debugWait();
     }
 
 }
@@ -6,6 +6,10 @@
   */
 
 #include "include/vectorization/vectorize.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
+#include "include/debugview.hpp"
+#include "include/binaryimage.hpp"
 
 #include <map>
 #include <cstdint>
@@ -36,105 +40,10 @@ struct vec2i_compare
 // the pixel at that position is 1, = 0 otherwise.
 // "Out-of-image" pixels are treated as 0. (check if this is ok!)
 //
-// Expects a binary matrix in which line pixels are black (= 0).
-uint8_t encodeNeighbors (Mat* image, pixel* curPixel)
+// Expects a packed skeleton in which line pixels are set.
+uint8_t encodeNeighbors (const BinaryImage& image, pixel* curPixel)
 {
-    int rows = image->rows;
-    int cols = image->cols;
-    int i = curPixel->coord[0]; // y-coordinate
-    int j = curPixel->coord[1]; // x-coordinate
-    uint8_t encoding = 0;
-
-
-    // top left pixel
-    if(i == 0 && j == 0)
-    {
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i+1, j+1) == 0) encoding += 4;
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-    }
-
-    // top right pixel
-    else if(i == 0 && j == (cols - 1))
-    {
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-        if(image->at<uchar>(i+1, j-1) == 0) encoding += 16;
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-    }
-
-
-    // bottom left pixel
-    else if (i == (rows - 1) && j == 0)
-    {
-        if(image->at<uchar>(i-1, j+1) == 0) encoding += 1;
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-    // bottom right pixel
-    else if (i == (rows - 1) && j == (cols - 1))
-    {
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-        if(image->at<uchar>(i-1, j-1) == 0) encoding += 64;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-    // upper border
-    else if (i == 0)
-    {
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i+1, j+1) == 0) encoding += 4;
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-        if(image->at<uchar>(i+1, j-1) == 0) encoding += 16;
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-    }
-
-    // left border
-    else if (j == 0)
-    {
-        if(image->at<uchar>(i-1, j+1) == 0) encoding += 1;
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i+1, j+1) == 0) encoding += 4;
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-
-    // right border
-    else if (j == (cols - 1))
-    {
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-        if(image->at<uchar>(i+1, j-1) == 0) encoding += 16;
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-        if(image->at<uchar>(i-1, j-1) == 0) encoding += 64;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-    // lower border
-    else if (i == (rows - 1))
-    {
-        if(image->at<uchar>(i-1, j+1) == 0) encoding += 1;
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-        if(image->at<uchar>(i-1, j-1) == 0) encoding += 64;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-    // Normal case - pixel is somewhere
-    // in the image, but not near any border.
-    else
-    {
-        if(image->at<uchar>(i-1, j+1) == 0) encoding += 1;
-        if(image->at<uchar>(i, j+1) == 0) encoding += 2;
-        if(image->at<uchar>(i+1, j+1) == 0) encoding += 4;
-        if(image->at<uchar>(i+1, j) == 0) encoding += 8;
-        if(image->at<uchar>(i+1, j-1) == 0) encoding += 16;
-        if(image->at<uchar>(i, j-1) == 0) encoding += 32;
-        if(image->at<uchar>(i-1, j-1) == 0) encoding += 64;
-        if(image->at<uchar>(i-1, j) == 0) encoding += 128;
-    }
-
-    return encoding;
+    return image.neighbors(curPixel->coord[0], curPixel->coord[1]);
 }
 
 // add rule "rule" to each table entry in the neighborhoods
@@ -608,7 +517,7 @@ void applyRule(Mat* image, pixel* cur, uint8_t nBits, int* ruleTable, set<vector
     Vec2i coord = cur->coord;
 
     if(coord == Vec2i(6, 9))
-        cout << "" ;
+        pipelineLog() << "" ;
 
     pixel* northEast = dummy;
     pixel* north = dummy;
@@ -755,7 +664,7 @@ void applyRule(Mat* image, pixel* cur, uint8_t nBits, int* ruleTable, set<vector
         default:
         {
             // Rule not specified - error
-            cout << "Rule " << rule << " was not specified!\n";
+            pipelineLog() << "Rule " << rule << " was not specified!\n";
             assert(rule > 0 && rule < 17);
         }
     }
@@ -854,7 +763,7 @@ void stateToImage (Mat image, int nbh)
 
     string number = std::to_string(nbh_orig);
     string filename = number + string(".png");
-    imwrite(filename.c_str(), image);
+    debugWrite(filename, image);
 }
 
 // Expects a thinned binary image (black = line pixels, white = background).
@@ -882,6 +791,9 @@ multimap<pixel*, vectorLine*> mooreVector(Mat image, vector<pixel*>* pixels, pix
 
     waitKey(0);*/
 
+    ScopedStageTimer timer("mooreVector");
+    long long skeletonPixels = 0;
+
     int ruleTable[256]; // links each neighborhood encoding to a rule
     initRuleTable(ruleTable);
 
@@ -890,23 +802,30 @@ multimap<pixel*, vectorLine*> mooreVector(Mat image, vector<pixel*>* pixels, pix
 
     // transform matrix points one by one
     // by applying rule according to neighborhood
-    for(int i = 0; i < image.rows; i++)
+    BinaryImage skeleton(image);
+
+    for(int i = 0; i < skeleton.rows(); i++)
     {
-        for(int j = 0; j < image.cols; j++)
+        const uint64_t* row = skeleton.row(i);
+
+        for(int w = 0; w < skeleton.words(); w++)
         {
-            // look only at black pixels
-            if(image.at<uchar>(i, j) == 0)
+            // look only at black pixels, left to right
+            for(uint64_t black = row[w]; black != 0; black &= black - 1)
             {
+                int j = w * 64 + lowestBit(black);
+
                 // get current pixel pointer
-                int64_t addr = i * image.cols + j;
+                int64_t addr = (int64_t) i * image.cols + j;
 
                 pixel* cur = pixels->at(addr);
 
                 // get neighborhood encoding of current pixel
-                uint8_t nbh = encodeNeighbors(&image, cur);
+                uint8_t nbh = encodeNeighbors(skeleton, cur);
 
                 // apply neighborhood rule
                 applyRule(&image, cur, nbh, ruleTable, &lines, pixels, dummy);
+                skeletonPixels++;
             }
         }
     }
@@ -930,5 +849,8 @@ multimap<pixel*, vectorLine*> mooreVector(Mat image, vector<pixel*>* pixels, pix
         nodeToLine.insert(make_pair((*l)->getEnd(), *l));
     }
 
+    countStage("mooreVector", "skeletonPixels", skeletonPixels);
+    countStage("mooreVector", "vectorLines", lines.size());
+
     return nodeToLine;
 }
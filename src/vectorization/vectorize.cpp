@@ -11,6 +11,9 @@
 #include "include/vectorization/zhangsuen.hpp"
 #include "include/vectorization/moore.hpp"
 #include "include/vectorization/douglaspeucker.h"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
+#include "include/pipelinelog.hpp"
 
 
 #include <iostream>
@@ -58,38 +61,15 @@ double localLineWidth (Vec2i coord, int windowSize, Mat* blacklayer, Mat* thinne
 }
 
 // Create a .svg file "filename.svg" based on the extracted vector lines.
-void vectorsToFile (Mat* blacklayer, Mat* thinned, Mat* original_image,
-                    vector<vector<pixel*>> paths, vector<colorPoly> colorpolys, string filename)
+void vectorsToFile (vector<VectorPath> paths, vector<colorPoly> colorpolys, Size size, string filename)
 {
-    namedWindow("before", WINDOW_NORMAL);
-    imshow("before", *thinned);
-
-    // debug: overlay found lines on image in blue
-    Mat vectoronly = Mat(thinned->rows, thinned->cols, thinned->type());
-    cvtColor(*thinned, vectoronly, CV_GRAY2RGB);
-
-
-    for(auto path = paths.begin(); path != paths.end(); path++)
-    {
-        for(auto p = (*path).begin(); p != (*path).end() - 1; p++)
-        {
-            pixel* start = *p;
-            pixel* end = *(p+1);
-
-            Point pt1 = Point(start->coord[1], start->coord[0]);
-            Point pt2 = Point(end->coord[1], end->coord[0]);
-
-            line(vectoronly, pt1, pt2, Scalar(255, 0, 0), 1);
-        }
-    }
-
-    namedWindow("VECTORS", WINDOW_NORMAL);
-    imshow("VECTORS", vectoronly);
+    ScopedStageTimer timer("vectorsToFile");
+    long long segments = 0;
 
     // Set up cairo canvas
     cairo_surface_t *surface;
     cairo_t *cr;
-    surface = cairo_svg_surface_create((filename + ".svg").c_str(), thinned->cols, thinned->rows);
+    surface = cairo_svg_surface_create((filename + ".svg").c_str(), size.width, size.height);
     cr = cairo_create(surface);
     cairo_set_source_rgb(cr, 0, 0, 0); // set color
     cairo_set_line_width(cr, 1); // set line width
@@ -125,48 +105,48 @@ void vectorsToFile (Mat* blacklayer, Mat* thinned, Mat* original_image,
     // Write line segment descriptions to .svg file
     for(auto path = paths.begin(); path != paths.end(); path++)
     {
-        for(auto p = (*path).begin(); p != (*path).end() - 1; p++)
+        for(int n = 0; n < (int) (*path).nodes.size() - 1; n++)
         {
-            pixel* start = *p;
-            pixel* end = *(p+1);
+            Vec2i start = (*path).nodes.at(n);
+            Vec2i end = (*path).nodes.at(n+1);
 
             // cairo can't handle 1px paths with square line caps
             // so draw a 1px square instead!
-            if(start->coord == end->coord)
+            if(start == end)
             {
                 // use "half" pixels to get squares that don't stretch
                 // over the border between two pixels if coordinate is odd
-                //if(start->coord[1] % 2 == 1)
-                    cairo_rectangle(cr, start->coord[1]-0.5, start->coord[0]-0.5, 1, 1);
+                //if(start[1] % 2 == 1)
+                    cairo_rectangle(cr, start[1]-0.5, start[0]-0.5, 1, 1);
 
                 //else
-                //    cairo_rectangle(cr, start->coord[1], start->coord[0], 1, 1);
+                //    cairo_rectangle(cr, start[1], start[0], 1, 1);
 
                 cairo_fill (cr);
+                segments++;
             }
 
             // draw normal line
             else
             {
-                // calculate local line width for both line endpoints
-                // and take mean as line width for entire line
-                double loc1 = localLineWidth(start->coord, 10, blacklayer, thinned);
-                double loc2 = localLineWidth(start->coord, 10, blacklayer, thinned);
-                double meanloc = (loc1 + loc2) / 2;
+                // use the local line width at the start node
+                // as line width for the entire line
+                cairo_set_line_width (cr, (*path).widths.at(n));
 
-                // set new linewidth
-                cairo_set_line_width (cr, meanloc);
-
-                cairo_move_to(cr, start->coord[1], start->coord[0]);
-                cairo_line_to(cr, end->coord[1], end->coord[0]);
+                cairo_move_to(cr, start[1], start[0]);
+                cairo_line_to(cr, end[1], end[0]);
                 cairo_stroke(cr);
 
                 // reset
                 cairo_set_line_width (cr, 1.);
+                segments++;
             }
         }
     }
 
+    countStage("vectorsToFile", "paths", paths.size());
+    countStage("vectorsToFile", "colorPolygons", colorpolys.size());
+    countStage("vectorsToFile", "svgSegments", segments);
 
     // Free canvas
     cairo_surface_destroy(surface);
@@ -179,6 +159,8 @@ void vectorsToFile (Mat* blacklayer, Mat* thinned, Mat* original_image,
 // are found.
 vector<vector<vectorLine*>> lineDFS (set<vectorLine*>* lines)
 {
+    ScopedStageTimer timer("lineDFS");
+
     vector<vector<vectorLine*>> local_paths; // holds paths found in current graph
     stack<vectorLine*> found; // nodes that still have to be walked
     set<vectorLine*> closed; // set of nodes that have been walked already
@@ -245,6 +227,8 @@ vector<vector<vectorLine*>> lineDFS (set<vectorLine*>* lines)
             found.push(*l);
     }
 
+    countStage("lineDFS", "paths", local_paths.size());
+
     return local_paths;
 }
 
@@ -254,6 +238,9 @@ vector<vector<vectorLine*>> lineDFS (set<vectorLine*>* lines)
 // between lines
 void fuseNodes(Mat image, vector<pixel*> pixels, multimap<pixel*, vectorLine*>* nodeToLine)
 {
+    ScopedStageTimer timer("fuseNodes");
+    countStage("fuseNodes", "nodesIn", nodeToLine->size());
+
     int height = image.rows;
     int width = image.cols;
 
@@ -583,7 +570,7 @@ vector<vector<pixel*>> refineVectors (Mat* image, multimap<pixel*, vectorLine*>*
         for(auto path = subPaths.begin(); path != subPaths.end(); path++)
             allPaths.push_back(*path);
 
-        cout << lines.size() << "\n";
+        pipelineLog() << lines.size() << "\n";
     }
 
     // Extract individual nodes of each path for use in
@@ -605,17 +592,24 @@ vector<vector<pixel*>> refineVectors (Mat* image, multimap<pixel*, vectorLine*>*
         pathsAsNodes.push_back(pathNodes);
     }
 
+    // douglasPeucker is recursive, so time all paths at once
+    ScopedStageTimer dpTimer("douglasPeucker");
+
     int i = 0;
     for(auto path = pathsAsNodes.begin(); path != pathsAsNodes.end(); path++)
     {
         if(i % 100 == 0)
-            cout << i * 100 << " lines refined\n";
+            pipelineLog() << i * 100 << " lines refined\n";
 
+        countStage("douglasPeucker", "nodesIn", (*path).size());
         *path = douglasPeucker(*path, epsilon);
+        countStage("douglasPeucker", "nodesOut", (*path).size());
         i++;
 
     }
 
+    countStage("douglasPeucker", "paths", pathsAsNodes.size());
+
     delete dummy;
     // delete pixels;
     // delete original lines?
@@ -630,6 +624,8 @@ vector<vector<pixel*>> refineVectors (Mat* image, multimap<pixel*, vectorLine*>*
 // can then be converted to filled vector polygons.
 vector<colorPoly> recoverTopology(Mat* original_image)
 {
+    ScopedStageTimer timer("recoverTopology");
+
     Mat meanShiftResult;
     Mat erodeResult(original_image->size(), original_image->type());
 
@@ -657,9 +653,8 @@ vector<colorPoly> recoverTopology(Mat* original_image)
     // remove black artifacts by mean shift filtering again
     pyrMeanShiftFiltering(meanShiftResult, meanShiftResult, 30, 30, 3);
 
-    namedWindow("second_meanshift", WINDOW_NORMAL);
-    imshow("second_meanshift", meanShiftResult);
-    imwrite("second_meanshift.png", meanShiftResult);
+    debugShow("second_meanshift", meanShiftResult);
+    debugWrite("second_meanshift.png", meanShiftResult);
 
     // convert to HSV
     Mat meanShiftHSV;
@@ -670,7 +665,7 @@ vector<colorPoly> recoverTopology(Mat* original_image)
     split(meanShiftHSV, channels);
     Mat hueChannel = channels[1];
 
-    imwrite("meanshift_H.png", hueChannel);
+    debugWrite("meanshift_H.png", hueChannel);
 
     // shift color space to get rid of hue channel artifacts
     Mat hueChannel_shifted = hueChannel.clone();/*
@@ -694,12 +689,15 @@ vector<colorPoly> recoverTopology(Mat* original_image)
     Mat edges;
     Canny(blurred, edges, 100, 50);
 
-    Mat contourMat = edges.clone();
-    cvtColor(edges, contourMat, CV_GRAY2BGR);
+    // debug: found contours drawn over the edges
+    bool visualize = debugViewEnabled();
+    Mat contourMat;
+
+    if(visualize)
+        cvtColor(edges, contourMat, CV_GRAY2BGR);
 
-    namedWindow("shift_canny", WINDOW_NORMAL);
-    imshow("shift_canny", edges);
-    imwrite("canny.png", edges);
+    debugShow("shift_canny", edges);
+    debugWrite("canny.png", edges);
 
     // get contours
     vector<vector<Point>> contours;
@@ -723,8 +721,7 @@ vector<colorPoly> recoverTopology(Mat* original_image)
             //bitwise_not(mask, mask);
             fillPoly(mask, &start, &numberpts, 1, color);
 
-            namedWindow("MASK", WINDOW_NORMAL);
-            imshow("MASK", mask);
+            debugShow("MASK", mask);
 
             // Compute the color in polygon area using polygon mask
             Scalar polycolor = mean(meanShiftResult, mask);
@@ -735,19 +732,20 @@ vector<colorPoly> recoverTopology(Mat* original_image)
 
             colorpolys.push_back(poly);
 
-
-            for(int z = 0; z < (int) contours[i].size()-1; z++)
+            if(visualize)
             {
-                line(contourMat, contours[i][z], contours[i][z+1], Scalar(0, 255, 0));
-            }
+                for(int z = 0; z < (int) contours[i].size()-1; z++)
+                {
+                    line(contourMat, contours[i][z], contours[i][z+1], Scalar(0, 255, 0));
+                }
 
-            line(contourMat, contours[i][contours[i].size()-1], contours[i][0], Scalar(0, 255, 0));
+                line(contourMat, contours[i][contours[i].size()-1], contours[i][0], Scalar(0, 255, 0));
+            }
         }
 
     }
 
-    namedWindow("contours", WINDOW_NORMAL);
-    imshow("contours", contourMat);
+    debugShow("contours", contourMat);
 
     return colorpolys;
 }
@@ -766,60 +764,130 @@ void initPixels(vector<pixel*>* pixels, Mat* image)
     }
 }
 
-// Expects binary image (blackLayer)
-void vectorizeImage (Mat* blacklayer, Mat* original_image, string filename, double epsilon)
+// Vectorizes the part "region" of a binary image and returns
+// the refined paths in image coordinates, together with the local
+// line width at each node.
+//
+// The skeleton is computed on the whole image, so if the image is a
+// padded tile, the skeleton inside the region matches the one of the
+// full sheet. Receives the skeleton in "thinnedOut" if it isn't NULL.
+vector<VectorPath> vectorizeRegion (Mat* blacklayer, Rect region, double epsilon, Mat* thinnedOut)
 {
-    cout << "\n ------------------------- \n";
-    cout << "Starting vectorization ...\n";
-
     multimap<pixel*, vectorLine*> nodeToLine; // provides a endpoint->line mapping
 
-    vector<pixel*>* pixels = new vector<pixel*>((blacklayer->rows + 2) * (blacklayer->cols + 2)); // states of all pixels (+ dummy values for 1px border)
+    vector<pixel*>* pixels = new vector<pixel*>((region.height + 2) * (region.width + 2)); // states of all pixels (+ dummy values for 1px border)
     pixel* dummy = new pixel(Vec2i(-1, -1), NULL, false);
-    initPixels(pixels, blacklayer);
 
-    Mat* inverted = new Mat(blacklayer->rows, blacklayer->cols, blacklayer->type());
-    Mat* thinned = new Mat(blacklayer->rows, blacklayer->cols, blacklayer->type());
+    Mat thinned;
 
     // thin image using Zhang-Suen
-    cout << "Extracting image skeleton... \n";
-    bitwise_not(*blacklayer, *inverted);
-    thinning(*inverted);
-    bitwise_not(*inverted, *thinned);
+    pipelineLog() << "Extracting image skeleton... \n";
+    BinaryImage skeleton(*blacklayer);
+    thinning(skeleton);
+    skeleton.toMat(&thinned);
 
     //imwrite("thinned.png", thinned);
 
+    // the Moore rules only see the skeleton inside the region
+    Mat regionThinned = thinned(region);
+    Mat regionBlack = (*blacklayer)(region);
+    initPixels(pixels, &regionThinned);
+
     // create vector lines
-    cout << "Extracting vectors from raster image... \n";
-    nodeToLine = mooreVector(*thinned, pixels, dummy);
+    pipelineLog() << "Extracting vectors from raster image... \n";
+    nodeToLine = mooreVector(regionThinned, pixels, dummy);
+
+    // remember all line objects before the refinement
+    // step starts rewiring the node->line mapping
+    set<vectorLine*> allLines;
+    for(auto l = nodeToLine.begin(); l != nodeToLine.end(); l++)
+        allLines.insert((*l).second);
 
     // refine vectors by removing unnecessary nodes
-    cout << "Refining vector data... \n";
+    pipelineLog() << "Refining vector data... \n";
     vector<vector<pixel*>> refinedPaths; // holds results of douglas-peucker algorithm
-    refinedPaths = refineVectors(blacklayer, &nodeToLine, pixels, epsilon);
+    refinedPaths = refineVectors(&regionBlack, &nodeToLine, pixels, epsilon);
 
-    cout << "Recovering image topology... \n";
-    // Determine color polygons
-    vector<colorPoly> colorpolys;
-    //colorpolys = recoverTopology(original_image);
+    // translate paths to image coordinates and
+    // determine the line width around each node
+    vector<VectorPath> paths;
 
-    // write vector lines to file
-    cout << "Writing vector data to file << " << filename << ".svg...\n";
-    vectorsToFile(blacklayer, thinned, original_image, refinedPaths, colorpolys, filename);
+    for(auto path = refinedPaths.begin(); path != refinedPaths.end(); path++)
+    {
+        VectorPath vp;
 
-    // delete allocated line objects
-    cout << "Cleaning up... \n";
-    /*for(auto l = refinedLines.begin(); l != refinedLines.end(); l++)
+        for(auto p = (*path).begin(); p != (*path).end(); p++)
+        {
+            Vec2i coord = (*p)->coord + Vec2i(region.y, region.x);
+
+            vp.nodes.push_back(coord);
+            vp.widths.push_back(localLineWidth(coord, 10, blacklayer, &thinned));
+        }
+
+        paths.push_back(vp);
+    }
+
+    // delete allocated line and pixel objects; batch runs
+    // process many sheets in one process, so nothing may leak here
+    for(auto l = allLines.begin(); l != allLines.end(); l++)
         delete (*l);
 
-    for(auto l = nodeToLine.begin(); l != nodeToLine.end(); l++)
-        delete (*l).second;
+    for(auto px = pixels->begin(); px != pixels->end(); px++)
+        delete (*px);
 
-    // deallocate pixel objects
-    for(auto l = nodeToLine.begin(); l != nodeToLine.end(); l++)
-        delete (*l).first;*/
+    delete pixels;
+    delete dummy;
+
+    if(thinnedOut != NULL)
+        *thinnedOut = thinned;
+
+    return paths;
+}
+
+// Expects binary image (blackLayer). Color polygons are only
+// recovered if the original color image is given (not NULL).
+void vectorizeImage (Mat* blacklayer, Mat* original_image, string filename, double epsilon)
+{
+    pipelineLog() << "\n ------------------------- \n";
+    pipelineLog() << "Starting vectorization ...\n";
+
+    Mat thinned;
+    vector<VectorPath> paths = vectorizeRegion(blacklayer, Rect(0, 0, blacklayer->cols, blacklayer->rows), epsilon, &thinned);
+
+    debugShow("before", thinned);
+
+    // debug: overlay found lines on image in blue
+    if(debugViewEnabled())
+    {
+        Mat vectoronly;
+        cvtColor(thinned, vectoronly, CV_GRAY2RGB);
+
+        for(auto path = paths.begin(); path != paths.end(); path++)
+            for(int n = 0; n < (int) (*path).nodes.size() - 1; n++)
+            {
+                Point pt1 = Point((*path).nodes.at(n)[1], (*path).nodes.at(n)[0]);
+                Point pt2 = Point((*path).nodes.at(n+1)[1], (*path).nodes.at(n+1)[0]);
+
+                line(vectoronly, pt1, pt2, Scalar(255, 0, 0), 1);
+            }
+
+        debugShow("VECTORS", vectoronly);
+    }
+
+    // Determine color polygons
+    vector<colorPoly> colorpolys;
+
+    if(original_image != NULL)
+    {
+        pipelineLog() << "Recovering image topology... \n";
+        colorpolys = recoverTopology(original_image);
+    }
+
+    // write vector lines to file
+    pipelineLog() << "Writing vector data to file << " << filename << ".svg...\n";
+    vectorsToFile(paths, colorpolys, thinned.size(), filename);
 
-    cout << "VECTORIZATION DONE!\n";
+    pipelineLog() << "VECTORIZATION DONE!\n";
 }
 
 
@@ -7,6 +7,8 @@
   */
 
 #include "include/vectorization/zhangsuen.hpp"
+#include "include/debugview.hpp"
+#include "include/stageprofiler.hpp"
 
 using namespace cv;
 
@@ -51,30 +53,159 @@ void thinningIteration(cv::Mat& im, int iter)
     im &= ~marker;
 }
 
+// Zhang-Suen deletion rule for both sub-iterations, indexed
+// by the neighborhood encoding of BinaryImage::neighbors().
+struct ThinningTable
+{
+    bool remove[2][256];
+
+    ThinningTable()
+    {
+        for(int iter = 0; iter < 2; iter++)
+            for(int nbh = 0; nbh < 256; nbh++)
+            {
+                int p2 = (nbh >> 7) & 1; // N
+                int p3 = nbh & 1;        // NE
+                int p4 = (nbh >> 1) & 1; // E
+                int p5 = (nbh >> 2) & 1; // SE
+                int p6 = (nbh >> 3) & 1; // S
+                int p7 = (nbh >> 4) & 1; // SW
+                int p8 = (nbh >> 5) & 1; // W
+                int p9 = (nbh >> 6) & 1; // NW
+
+                int A  = (p2 == 0 && p3 == 1) + (p3 == 0 && p4 == 1) +
+                         (p4 == 0 && p5 == 1) + (p5 == 0 && p6 == 1) +
+                         (p6 == 0 && p7 == 1) + (p7 == 0 && p8 == 1) +
+                         (p8 == 0 && p9 == 1) + (p9 == 0 && p2 == 1);
+                int B  = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
+                int m1 = iter == 0 ? (p2 * p4 * p6) : (p2 * p4 * p8);
+                int m2 = iter == 0 ? (p4 * p6 * p8) : (p2 * p6 * p8);
+
+                remove[iter][nbh] = A == 1 && (B >= 2 && B <= 6) && m1 == 0 && m2 == 0;
+            }
+    }
+};
+
 /**
- * Function for thinning the given binary image
+ * Perform one thinning iteration on a packed image.
+ * Only set pixels away from the image border are inspected,
+ * 64 pixels per word; empty words are skipped.
  *
- * @param  im  Binary image with range = 0-255
+ * @param  im      Packed binary image, set bits = foreground
+ * @param  iter    0=even, 1=odd
+ * @param  marker  Scratch image of the same size
+ * @return true if any pixel was removed
  */
-void thinning(cv::Mat& im)
+static bool thinningIteration(BinaryImage& im, int iter, BinaryImage& marker)
+{
+    static const ThinningTable table;
+    bool changed = false;
+
+    for (int i = 1; i < im.rows()-1; i++)
+    {
+        uint64_t* markerRow = marker.row(i);
+
+        for (int w = 0; w < im.words(); w++)
+        {
+            int j0 = w * 64;
+
+            // interior pixels of this word
+            uint64_t candidates = im.row(i)[w];
+            if (j0 == 0)
+                candidates &= ~(uint64_t) 1;
+            if (j0 + 64 >= im.cols())
+                candidates &= ((uint64_t) 1 << (im.cols() - 1 - j0)) - 1;
+
+            markerRow[w] = 0;
+
+            if (candidates == 0)
+                continue;
+
+            // neighbors of the 64 pixels, one word per direction
+            uint64_t n  = im.row(i-1)[w];
+            uint64_t ne = im.span(i-1, j0+1);
+            uint64_t e  = im.span(i, j0+1);
+            uint64_t se = im.span(i+1, j0+1);
+            uint64_t s  = im.row(i+1)[w];
+            uint64_t sw = im.span(i+1, j0-1);
+            uint64_t wd = im.span(i, j0-1);
+            uint64_t nw = im.span(i-1, j0-1);
+
+            uint64_t remove = 0;
+
+            while (candidates != 0)
+            {
+                int b = lowestBit(candidates);
+                candidates &= candidates - 1;
+
+                int nbh = ((ne >> b) & 1)
+                        | ((e  >> b) & 1) << 1
+                        | ((se >> b) & 1) << 2
+                        | ((s  >> b) & 1) << 3
+                        | ((sw >> b) & 1) << 4
+                        | ((wd >> b) & 1) << 5
+                        | ((nw >> b) & 1) << 6
+                        | ((n  >> b) & 1) << 7;
+
+                if (table.remove[iter][nbh])
+                    remove |= (uint64_t) 1 << b;
+            }
+
+            markerRow[w] = remove;
+            changed |= remove != 0;
+        }
+    }
+
+    // all pixels of one sub-iteration are removed at once
+    for (int i = 1; i < im.rows()-1; i++)
+        for (int w = 0; w < im.words(); w++)
+            im.row(i)[w] &= ~marker.row(i)[w];
+
+    return changed;
+}
+
+/**
+ * Function for thinning a packed binary image
+ *
+ * @param  im  Packed binary image, set bits = foreground
+ */
+void thinning(BinaryImage& im)
 {
-    im /= 255;
+    ScopedStageTimer timer("thinning");
+    long long iterations = 0;
 
-    cv::Mat prev = cv::Mat::zeros(im.size(), CV_8UC1);
-    cv::Mat diff;
+    BinaryImage marker(im.rows(), im.cols());
+    bool changed;
 
     do
     {
-        thinningIteration(im, 0);
-        thinningIteration(im, 1);
-        cv::absdiff(im, prev, diff);
-        im.copyTo(prev);
+        changed = thinningIteration(im, 0, marker);
+        changed |= thinningIteration(im, 1, marker);
+        iterations++;
     }
-    while (cv::countNonZero(diff) > 0);
+    while (changed);
 
-    im *= 255;
+    countStage("thinning", "pixels", (long long) im.rows() * im.cols());
+    countStage("thinning", "iterations", iterations);
+    countStage("thinning", "skeletonPixels", im.count());
 
-    namedWindow("Thinned", WINDOW_NORMAL);
-    imshow("Thinned", im);
+    if (debugViewEnabled())
+    {
+        cv::Mat show;
+        im.toMat(&show, 255, 0);
+        debugShow("Thinned", show);
+    }
+}
+
+/**
+ * Function for thinning the given binary image
+ *
+ * @param  im  Binary image with range = 0-255
+ */
+void thinning(cv::Mat& im)
+{
+    BinaryImage packed(im, 255);
 
+    thinning(packed);
+    packed.toMat(&im, 255, 0);
 }
@@ -0,0 +1,179 @@
+/**
+  * Checks the component filters: the predicates at the bounds they
+  * promise, filterComponents and selectComponents against keeping the
+  * components one by one (same components, same order), and the index
+  * view filters of clusters, including the LMS outlier rejection.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/areafilter.hpp"
+#include "include/text_segmentation/componentstore.hpp"
+#include "include/text_segmentation/auxiliary.hpp"
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+
+// A component with an MBR of rows x cols pixels at (row, col);
+// the seed tells the components apart.
+static ConnectedComponent makeComponent (int row, int col, int rows, int cols, int pixels, int seed)
+{
+    ConnectedComponent comp = ConnectedComponent(Vec2i(row, col), Vec2i(row + rows - 1, col + cols - 1), pixels, Vec2i(seed, 0));
+    comp.area = getMBRArea(comp);
+
+    return comp;
+}
+
+// Fixed cases at the bounds of the predicates and of the LMS filter.
+// Returns the number of failed checks.
+static int boundaryChecks ()
+{
+    int failures = 0;
+
+    struct Check { const char* name; bool passed; };
+
+    // (getMBRArea measures the MBR from corner to corner, so the
+    // area is smaller than the number of pixels in it)
+    ConnectedComponent tall = makeComponent(0, 0, 12, 4, 20, 0); // 3:1
+    ConnectedComponent wide = makeComponent(5, 5, 4, 12, 20, 1); // 1:3
+    ConnectedComponent wider = makeComponent(5, 5, 4, 13, 20, 2); // 1:3.25
+    ConnectedComponent box = makeComponent(0, 0, 4, 5, 10, 3); // 20 pixels in the MBR
+
+    int area = tall.area;
+    ComponentFilter both = ComponentFilter().add(areaBetween(area - 5, area + 5)).add(densityAtLeast(0.4));
+
+    const Check checks[] =
+    {
+        { "aspect ratio 3:1 at most 3", aspectRatioAtMost(3)(tall) },
+        { "aspect ratio 1:3 at most 3", aspectRatioAtMost(3)(wide) },
+        { "aspect ratio 1:3.25 not at most 3", !aspectRatioAtMost(3)(wider) },
+        { "aspect ratio 3:1 not at most 2", !aspectRatioAtMost(2)(tall) },
+        { "density 0.5 at least 0.5", densityAtLeast(0.5)(box) },
+        { "density 0.5 not at least 0.55", !densityAtLeast(0.55)(box) },
+        { "area between area and area", areaBetween(area, area)(tall) },
+        { "area not between area + 1 and 1000", !areaBetween(area + 1, 1000)(tall) },
+        { "area not between 1 and area - 1", !areaBetween(1, area - 1)(tall) },
+        { "empty filter keeps all", ComponentFilter()(wider) },
+        { "filter keeps if all predicates do", both(tall) },
+        { "filter rejects if one predicate does", !ComponentFilter().add(areaBetween(area - 5, area + 5)).add(densityAtLeast(0.5))(tall) }
+    };
+
+    for(size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++)
+        if(!checks[c].passed)
+        {
+            cout << "check failed: " << checks[c].name << "\n";
+            failures++;
+        }
+
+    // LMS: one component far larger than the rest of the cluster
+    ComponentStore store;
+    vector<int> cluster;
+
+    for(int c = 0; c < 12; c++)
+        cluster.push_back(store.add(makeComponent(0, 10 * c, 6 + c % 2, 4, 10, c)));
+
+    int huge = store.add(makeComponent(0, 200, 60, 40, 500, 12));
+    cluster.insert(cluster.begin() + 5, huge);
+
+    vector<int> single(1, huge), empty;
+    ClusterFilter lms = ClusterFilter().add(areaInliers(40));
+
+    lms(store, &cluster);
+    lms(store, &single);
+    lms(store, &empty);
+
+    if(cluster.size() != 12 || find(cluster.begin(), cluster.end(), huge) != cluster.end())
+    {
+        cout << "check failed: LMS keeps the similar areas and drops the outlier\n";
+        failures++;
+    }
+
+    for(size_t i = 1; i < cluster.size(); i++)
+        if(store.area[cluster[i - 1]] > store.area[cluster[i]])
+        {
+            cout << "check failed: LMS leaves the cluster sorted by area\n";
+            failures++;
+            break;
+        }
+
+    if(single.size() != 1 || single[0] != huge || !empty.empty())
+    {
+        cout << "check failed: LMS leaves clusters of zero or one component alone\n";
+        failures++;
+    }
+
+    return failures;
+}
+
+// Returns the number of random component lists (plus fixed checks)
+// for which the filters don't keep the expected components.
+int areaFilterTest (int images)
+{
+    mt19937 random(13);
+    int failures = boundaryChecks();
+
+    for(int n = 0; n < images; n++)
+    {
+        int count = random() % 200;
+        vector<ConnectedComponent> components;
+
+        for(int c = 0; c < count; c++)
+        {
+            int rows = 1 + random() % 30;
+            int cols = 1 + random() % 30;
+
+            components.push_back(makeComponent(random() % 500, random() % 500, rows, cols, 1 + random() % (rows * cols), c));
+        }
+
+        ComponentFilter filter;
+
+        if(random() % 2)
+            filter.add(aspectRatioAtMost(1 + random() % 4));
+        if(random() % 2)
+            filter.add(densityAtLeast((random() % 100) / 100.));
+        if(random() % 2)
+            filter.add(areaBetween(random() % 100, 50 + random() % 500));
+
+        // expected: the kept components, one by one and in order
+        vector<int> expected;
+
+        for(int c = 0; c < count; c++)
+            if(filter(components[c]))
+                expected.push_back(c);
+
+        vector<int> selected = selectComponents(components, filter);
+
+        vector<ConnectedComponent> filtered(components);
+        filterComponents(&filtered, filter);
+
+        bool same = selected == expected && filtered.size() == expected.size();
+
+        for(size_t k = 0; same && k < expected.size(); k++)
+            same = filtered[k].seed == components[expected[k]].seed;
+
+        // the same filter on an index view of the components
+        ComponentStore store = ComponentStore(components);
+        vector<int> view;
+
+        for(int c = 0; c < count; c++)
+            view.push_back(c);
+
+        ClusterFilter().add(filter)(store, &view);
+        same = same && view == expected;
+
+        if(!same)
+        {
+            cout << "list " << n << " (" << count << " components): filtered components differ\n";
+            failures++;
+        }
+    }
+
+    return failures;
+}
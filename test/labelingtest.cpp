@@ -0,0 +1,184 @@
+/**
+  * Checks unionFindComponents against a simple scalar labeling: a flood
+  * fill of each black pixel not labeled yet, in raster order. Both have
+  * to number the components the same way (by their first pixel), so the
+  * label images, the removed components and the component lists have
+  * to be equal. The images are random or built to be hard for the block
+  * labeling: checkerboards, diagonal lines and single rows or columns.
+  * Every image is labeled in 1 .. N strips, down to strips of a single
+  * block row, so most rows of the patterns lie at a strip border.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/blocklabeling.hpp"
+
+#include <iostream>
+#include <vector>
+#include <stack>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+
+// Labels the 8-connected black pixels of the image one component at a
+// time, numbered in raster order of their first pixel. Components with
+// less than minPx pixels are made white and get label 0; the others
+// are returned in the same order.
+static void referenceLabeling (Mat* image, int minPx, Mat* labels, vector<ConnectedComponent>* components)
+{
+    *labels = Mat::zeros(image->rows, image->cols, CV_32S);
+    int next = 0;
+
+    for(int i = 0; i < image->rows; i++)
+        for(int j = 0; j < image->cols; j++)
+        {
+            if(image->at<uchar>(i, j) != 0 || labels->at<int>(i, j) != 0)
+                continue;
+
+            int label = ++next;
+            vector<Vec2i> pixels;
+            stack<Vec2i> active;
+
+            labels->at<int>(i, j) = label;
+            active.push(Vec2i(i, j));
+
+            Vec2i mbrMin = Vec2i(i, j), mbrMax = Vec2i(i, j);
+
+            while(!active.empty())
+            {
+                Vec2i p = active.top();
+                active.pop();
+                pixels.push_back(p);
+
+                mbrMin = Vec2i(min(mbrMin[0], p[0]), min(mbrMin[1], p[1]));
+                mbrMax = Vec2i(max(mbrMax[0], p[0]), max(mbrMax[1], p[1]));
+
+                for(int di = -1; di <= 1; di++)
+                    for(int dj = -1; dj <= 1; dj++)
+                    {
+                        int y = p[0] + di;
+                        int x = p[1] + dj;
+
+                        if(y >= 0 && y < image->rows && x >= 0 && x < image->cols &&
+                           image->at<uchar>(y, x) == 0 && labels->at<int>(y, x) == 0)
+                        {
+                            labels->at<int>(y, x) = label;
+                            active.push(Vec2i(y, x));
+                        }
+                    }
+            }
+
+            if((int) pixels.size() < minPx)
+            {
+                for(auto p = pixels.begin(); p != pixels.end(); p++)
+                {
+                    image->at<uchar>((*p)[0], (*p)[1]) = 255;
+                    labels->at<int>((*p)[0], (*p)[1]) = 0;
+                }
+
+                continue;
+            }
+
+            components->push_back(ConnectedComponent(mbrMin, mbrMax, pixels.size(), Vec2i(i, j)));
+            components->back().label = label;
+        }
+}
+
+// Fills an image with one of the patterns that are hard for the
+// block labeling, or with random pixels.
+static void makeImage (Mat* image, int pattern, mt19937* random)
+{
+    int density = (*random)() % 100; // percentage of black pixels
+    int period = 2 + (*random)() % 4;
+
+    for(int i = 0; i < image->rows; i++)
+        for(int j = 0; j < image->cols; j++)
+        {
+            bool black;
+
+            switch(pattern)
+            {
+                case 0: black = (i + j) % 2 == 0; break; // checkerboard: diagonal connectivity only
+                case 1: black = (i + j) % period == 0; break; // diagonal lines
+                case 2: black = (i - j + 1000 * period) % period == 0; break; // anti-diagonal lines
+                case 3: black = i % period == 0 && (j + i / period) % 2 == 0; break; // dotted rows
+                case 4: black = (i % 2 == 0) != (j % period == 0); break; // rows and columns joined by corners
+                case 5: black = j % period == (i % 2 == 0 ? 1 : 0); break; // zigzags: rows only touch diagonally
+                default: black = (int) ((*random)() % 100) < density; break;
+            }
+
+            image->at<uchar>(i, j) = black ? 0 : 255;
+        }
+}
+
+// Returns the number of images whose labeling differs from the reference.
+int labelingTest (int cases)
+{
+    mt19937 random(17);
+    int failures = 0;
+
+    for(int n = 0; n < cases; n++)
+    {
+        // single rows and columns, odd sizes and sizes of several words
+        int rows = random() % 4 == 0 ? 1 + random() % 3 : 1 + random() % 90;
+        int cols = random() % 4 == 0 ? 1 + random() % 3 : 1 + random() % 150;
+        int pattern = random() % 9;
+        int minPx = random() % 3 == 0 ? 0 : random() % 6;
+
+        Mat image = Mat(rows, cols, CV_8U);
+        makeImage(&image, pattern, &random);
+
+        Mat expected = image.clone();
+        Mat expectedLabels;
+        vector<ConnectedComponent> expectedComps;
+
+        referenceLabeling(&expected, minPx, &expectedLabels, &expectedComps);
+
+        // 1 .. 8 strips and one strip per block row
+        int blockRows = (rows + 1) / 2;
+        vector<int> stripCounts;
+
+        for(int strips = 1; strips <= min(8, blockRows); strips++)
+            stripCounts.push_back(strips);
+
+        if(blockRows > 8)
+            stripCounts.push_back(blockRows);
+
+        for(auto strips = stripCounts.begin(); strips != stripCounts.end(); strips++)
+        {
+            setLabelingStrips(*strips);
+
+            Mat labeled = image.clone();
+            Mat labels;
+            vector<ConnectedComponent> components;
+
+            int numLabels = unionFindComponents(&labeled, &components, minPx, 0, &labels);
+
+            bool same = components.size() == expectedComps.size()
+                        && countNonZero(labeled != expected) == 0
+                        && countNonZero(labels != expectedLabels) == 0;
+
+            for(size_t c = 0; same && c < components.size(); c++)
+                same = components[c].label == expectedComps[c].label && components[c].seed == expectedComps[c].seed
+                       && components[c].mbr_min == expectedComps[c].mbr_min && components[c].mbr_max == expectedComps[c].mbr_max
+                       && components[c].numBlackPixels == expectedComps[c].numBlackPixels && components[c].label <= numLabels;
+
+            if(!same)
+            {
+                cout << "image " << n << " (" << rows << " x " << cols << ", pattern " << pattern << "), "
+                     << *strips << " strips: labeling differs from the reference\n";
+                failures++;
+                break;
+            }
+        }
+    }
+
+    setLabelingStrips(0);
+
+    return failures;
+}
@@ -0,0 +1,77 @@
+/**
+  * Runs the tests of the pipeline stages.
+  *
+  * Usage:
+  *   cityplan_tests [test] [cases]
+  *       Runs all tests, or only the named one, on their default
+  *       number of random cases (images or component lists) or on
+  *       the given number. Exits with 1 if any case fails.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/debugview.hpp"
+#include "include/pipelinelog.hpp"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+
+struct Test
+{
+    const char* name;
+    int (*run) (int cases);
+    int cases; // default number of cases
+};
+
+static const Test tests[] =
+{
+    { "areafilter", areaFilterTest, 500 },
+    { "labeling", labelingTest, 1500 },
+    { "relabel", relabelTest, 1500 },
+    { "runs", runsTest, 1000 },
+    { "tiledtext", tiledTextTest, 60 },
+    { "unionfind", unionFindTest, 300 }
+};
+
+int main (int argc, char** argv)
+{
+    string only = argc > 1 ? argv[1] : "";
+    int cases = argc > 2 ? max(1, atoi(argv[2])) : 0;
+
+    setDebugView(false);
+
+    // the stages log every call; only failures are of interest
+    ostream discarded(NULL);
+    setPipelineLog(&discarded);
+
+    int failures = 0;
+    bool found = false;
+
+    for(size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++)
+    {
+        if(!only.empty() && only != tests[t].name)
+            continue;
+
+        int n = cases > 0 ? cases : tests[t].cases;
+        int failed = tests[t].run(n);
+
+        cout << tests[t].name << ": " << n << " cases, " << failed << " failures\n";
+
+        failures += failed;
+        found = true;
+    }
+
+    if(!found)
+    {
+        cout << "Unknown test: " << only << "\n";
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
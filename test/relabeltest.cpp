@@ -0,0 +1,162 @@
+/**
+  * Checks relabelRegions against a full labeling: random images are
+  * labeled and filtered, edited in random rectangles (pixels made black
+  * or white) and relabeled, and the result is compared with labeling
+  * and filtering the edited image again.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/areafilter.hpp"
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+
+// MBR, pixel count and first pixel of a component
+typedef tuple<int, int, int, int, int, int, int> ComponentKey;
+
+// The components of a list, independent of their order and labels.
+static vector<ComponentKey> componentKeys (const vector<ConnectedComponent>& components)
+{
+    vector<ComponentKey> keys;
+
+    for(auto comp = components.begin(); comp != components.end(); comp++)
+        keys.push_back(ComponentKey((*comp).mbr_min[0], (*comp).mbr_min[1], (*comp).mbr_max[0], (*comp).mbr_max[1],
+                                    (*comp).numBlackPixels, (*comp).seed[0], (*comp).seed[1]));
+
+    sort(keys.begin(), keys.end());
+
+    return keys;
+}
+
+// True if both label images put the black pixels into the same sets
+// and label all white pixels with 0.
+static bool samePartition (const Mat& input, const Mat& labels, const Mat& expected)
+{
+    map<int, int> toExpected, fromExpected;
+
+    for(int i = 0; i < input.rows; i++)
+        for(int j = 0; j < input.cols; j++)
+        {
+            int l = labels.at<int>(i, j);
+            int e = expected.at<int>(i, j);
+
+            if(input.at<uchar>(i, j) != 0)
+            {
+                if(l != 0 || e != 0)
+                    return false;
+
+                continue;
+            }
+
+            if(l == 0 || e == 0)
+                return false;
+
+            auto to = toExpected.insert(make_pair(l, e));
+            auto from = fromExpected.insert(make_pair(e, l));
+
+            if((*to.first).second != e || (*from.first).second != l)
+                return false;
+        }
+
+    return true;
+}
+
+// Edits rectangles of the image; each one gets black or white
+// pixels (about two thirds of its pixels are changed).
+static vector<Rect> editImage (Mat* image, mt19937* random)
+{
+    vector<Rect> modified;
+    int edits = 1 + (*random)() % 3;
+
+    for(int e = 0; e < edits; e++)
+    {
+        Rect rect = Rect((*random)() % image->cols, (*random)() % image->rows, 1 + (*random)() % 6, 1 + (*random)() % 6);
+        rect &= Rect(0, 0, image->cols, image->rows);
+
+        uchar value = (*random)() % 2 ? 0 : 255;
+
+        for(int i = rect.y; i < rect.y + rect.height; i++)
+            for(int j = rect.x; j < rect.x + rect.width; j++)
+                if((*random)() % 3 != 0)
+                    image->at<uchar>(i, j) = value;
+
+        modified.push_back(rect);
+    }
+
+    return modified;
+}
+
+// Returns the number of images whose relabeling differs.
+int relabelTest (int images)
+{
+    mt19937 random(5);
+    int failures = 0;
+
+    for(int n = 0; n < images; n++)
+    {
+        int rows = 2 + random() % 40;
+        int cols = 2 + random() % 80;
+        int density = random() % 70; // percentage of black pixels
+        int minPx = random() % 4;
+
+        ComponentFilter filter;
+        filter.add(aspectRatioAtMost(1 + random() % 3));
+
+        if(random() % 2)
+            filter.add(areaBetween(1 + random() % 4, 40 + random() % 200));
+
+        Mat image = Mat(rows, cols, CV_8U);
+
+        for(int i = 0; i < rows; i++)
+            for(int j = 0; j < cols; j++)
+                image.at<uchar>(i, j) = (int) (random() % 100) < density ? 0 : 255;
+
+        vector<ConnectedComponent> components;
+        Mat labels;
+
+        int numLabels = unionFindComponents(&image, &components, minPx, 0, &labels);
+        filterComponents(&components, filter);
+
+        // several edits in a row, so relabeled images are relabeled again
+        for(int round = 0; round < 3; round++)
+        {
+            vector<Rect> modified = editImage(&image, &random);
+            numLabels = relabelRegions(&image, &labels, numLabels, &components, modified, minPx, filter);
+
+            Mat full = image.clone();
+            vector<ConnectedComponent> fullComponents;
+            Mat fullLabels;
+
+            unionFindComponents(&full, &fullComponents, minPx, 0, &fullLabels);
+            filterComponents(&fullComponents, filter);
+
+            bool same = componentKeys(components) == componentKeys(fullComponents)
+                        && countNonZero(full != image) == 0
+                        && samePartition(image, labels, fullLabels);
+
+            for(auto comp = components.begin(); comp != components.end(); comp++)
+                same = same && (*comp).label >= 1 && (*comp).label <= numLabels;
+
+            if(!same)
+            {
+                cout << "image " << n << " (" << rows << " x " << cols << "), edit " << round << ": relabeling differs from the full labeling\n";
+                failures++;
+                break;
+            }
+        }
+    }
+
+    return failures;
+}
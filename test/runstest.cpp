@@ -0,0 +1,125 @@
+/**
+  * Checks the pixel runs of unionFindComponents against its label image:
+  * on random images, the runs of each kept component have to cover
+  * exactly the pixels with its label, and erasing a component by its
+  * runs has to give the same image as erasing it by its label.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/opencvincludes.hpp"
+#include "include/text_segmentation/auxiliary.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+
+// True if the runs of the component hold exactly the pixels
+// with its label, each once and in row order.
+static bool runsMatchLabel (const ConnectedComponent& comp, const vector<PixelRun>& runs, const Mat& labels)
+{
+    if(comp.numRuns == 0 || comp.firstRun + comp.numRuns > (int) runs.size())
+        return false;
+
+    int pixels = 0;
+    int lastRow = -1;
+
+    for(int r = comp.firstRun; r < comp.firstRun + comp.numRuns; r++)
+    {
+        const PixelRun& run = runs[r];
+
+        if(run.row < lastRow || run.colStart > run.colEnd)
+            return false;
+
+        for(int j = run.colStart; j <= run.colEnd; j++)
+            if(labels.at<int>(run.row, j) != comp.label)
+                return false;
+
+        // runs are maximal: the pixels around them belong to other labels
+        if((run.colStart > 0 && labels.at<int>(run.row, run.colStart - 1) == comp.label) ||
+           (run.colEnd < labels.cols - 1 && labels.at<int>(run.row, run.colEnd + 1) == comp.label))
+            return false;
+
+        pixels += run.colEnd - run.colStart + 1;
+        lastRow = run.row;
+    }
+
+    return pixels == comp.numBlackPixels;
+}
+
+// Returns the number of images whose runs differ from the labels.
+int runsTest (int images)
+{
+    mt19937 random(11);
+    int failures = 0;
+
+    for(int n = 0; n < images; n++)
+    {
+        int rows = 1 + random() % 60;
+        int cols = 1 + random() % 150; // also rows longer than one word
+        int density = random() % 80;
+        int minPx = random() % 4;
+
+        Mat image = Mat(rows, cols, CV_8U);
+
+        for(int i = 0; i < rows; i++)
+            for(int j = 0; j < cols; j++)
+                image.at<uchar>(i, j) = (int) (random() % 100) < density ? 0 : 255;
+
+        vector<ConnectedComponent> components;
+        vector<PixelRun> runs;
+        Mat labels;
+
+        unionFindComponents(&image, &components, minPx, 0, &labels, &runs);
+
+        bool same = true;
+        int total = 0;
+
+        for(auto comp = components.begin(); same && comp != components.end(); comp++)
+        {
+            same = runsMatchLabel(*comp, runs, labels) && (*comp).firstRun == total;
+            total += (*comp).numRuns;
+        }
+
+        same = same && total == (int) runs.size();
+
+        // erase every other component both ways
+        Mat byRuns = image.clone();
+        Mat byLabel = image.clone();
+
+        for(size_t c = 0; same && c < components.size(); c += 2)
+        {
+            eraseComponentRuns(components[c], runs, &byRuns);
+            eraseComponentLabel(components[c], labels, &byLabel);
+        }
+
+        same = same && countNonZero(byRuns != byLabel) == 0;
+
+        // the runs don't depend on the label image being asked for
+        Mat copy = image.clone();
+        vector<ConnectedComponent> withoutLabels;
+        vector<PixelRun> runsWithoutLabels;
+
+        unionFindComponents(&copy, &withoutLabels, minPx, 0, NULL, &runsWithoutLabels);
+
+        same = same && runsWithoutLabels.size() == runs.size();
+
+        for(size_t r = 0; same && r < runs.size(); r++)
+            same = runs[r].row == runsWithoutLabels[r].row && runs[r].colStart == runsWithoutLabels[r].colStart
+                   && runs[r].colEnd == runsWithoutLabels[r].colEnd;
+
+        if(!same)
+        {
+            cout << "image " << n << " (" << rows << " x " << cols << "): runs differ from the label image\n";
+            failures++;
+        }
+    }
+
+    return failures;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// The tests run by cityplan_tests (see test/main.cpp). Each one
+// checks that many random cases (images or component lists),
+// prints the ones that fail and returns their number.
+int areaFilterTest (int cases);
+int labelingTest (int cases);
+int relabelTest (int cases);
+int runsTest (int cases);
+int tiledTextTest (int cases);
+int unionFindTest (int cases);
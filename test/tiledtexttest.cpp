@@ -0,0 +1,149 @@
+/**
+  * Checks that the tiled pipeline removes the same text as the untiled
+  * one: random images with strings of character-sized blobs (crossing
+  * the tile seams in all directions) and long strokes are labeled,
+  * filtered and cleared of text once on the whole image and once in
+  * tiles of a random size, and both results are compared.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/opencvincludes.hpp"
+#include "include/tiling.hpp"
+#include "include/text_segmentation/unionfindcomponents.hpp"
+#include "include/text_segmentation/areafilter.hpp"
+#include "include/text_segmentation/collineargrouping.hpp"
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+
+// Sets a pixel to black if it lies in the image.
+static void setBlack (Mat* image, int i, int j)
+{
+    if(i >= 0 && i < image->rows && j >= 0 && j < image->cols)
+        image->at<uchar>(i, j) = 0;
+}
+
+// Draws a string of glyphs the size of characters, starting at (row, col)
+// and running right (dRow = 0), down (dCol = 0) or diagonally. Each glyph
+// is made of some of the strokes of its box, so its first pixel usually
+// isn't the corner of its MBR.
+static void drawString (Mat* image, int row, int col, int dRow, int dCol, mt19937* random)
+{
+    int chars = 4 + (*random)() % 12;
+    int height = 5 + (*random)() % 4;
+    int width = 3 + (*random)() % 3;
+    int gap = 2 + (*random)() % 3;
+
+    for(int c = 0; c < chars; c++)
+    {
+        int top = row + c * dRow * (height + gap);
+        int left = col + c * dCol * (width + gap);
+        int strokes = 1 + (*random)() % 31; // top, middle, bottom, left, right
+
+        // the diagonal keeps the strokes connected
+        for(int i = 0; i < height; i++)
+            setBlack(image, top + i, left + (width - 1) - i * (width - 1) / (height - 1));
+
+        for(int i = 0; i < height; i++)
+            for(int j = 0; j < width; j++)
+                if(((strokes & 1) && i == 0) || ((strokes & 2) && i == height / 2) || ((strokes & 4) && i == height - 1) ||
+                   ((strokes & 8) && j == 0) || ((strokes & 16) && j == width - 1))
+                    setBlack(image, top + i, left + j);
+    }
+}
+
+// Draws a one pixel wide stroke from (row, col) in the given direction.
+static void drawStroke (Mat* image, int row, int col, int dRow, int dCol, int length)
+{
+    for(int k = 0; k < length; k++)
+        setBlack(image, row + k * dRow, col + k * dCol);
+}
+
+// Returns the number of black pixels in a binary image.
+static int blackPixels (const Mat& image)
+{
+    return image.rows * image.cols - countNonZero(image);
+}
+
+// Returns the number of images whose tiled text removal differs.
+int tiledTextTest (int images)
+{
+    mt19937 random(7);
+    int failures = 0;
+    long long removed = 0; // text pixels removed in all images
+
+    for(int n = 0; n < images; n++)
+    {
+        int rows = 60 + random() % 120;
+        int cols = 80 + random() % 200;
+        int tileSize = 8 + random() % 64;
+        int minPx = random() % 6;
+
+        Mat image = Mat(rows, cols, CV_8U, Scalar(255));
+
+        int strings = 1 + random() % 5;
+
+        for(int s = 0; s < strings; s++)
+        {
+            int direction = random() % 3;
+            drawString(&image, random() % rows, random() % cols, direction == 0 ? 0 : 1, direction == 1 ? 0 : 1, &random);
+        }
+
+        int strokes = random() % 4;
+
+        for(int s = 0; s < strokes; s++)
+        {
+            int direction = random() % 3; // right, down or down to the left
+            drawStroke(&image, random() % rows, random() % cols, direction == 0 ? 0 : 1, direction == 0 ? 1 : (direction == 1 ? 0 : -1),
+                       20 + random() % 100);
+        }
+
+        // whole image
+        Mat untiled = image.clone();
+        vector<ConnectedComponent> components;
+        Mat labels;
+
+        unionFindComponents(&untiled, &components, minPx, 0, &labels);
+        areaFilter(&components, 10);
+
+        int before = blackPixels(untiled);
+        collinearGrouping(untiled, &untiled, &components, &labels);
+        removed += before - blackPixels(untiled);
+
+        // tiles
+        Mat tiled = image.clone();
+        vector<ConnectedComponent> tiledComps;
+
+        tiledComponents(&tiled, &tiledComps, minPx, tileSize);
+        areaFilter(&tiledComps, 10);
+        tiledTextRemoval(&tiled, tiledComps);
+
+        bool same = components.size() == tiledComps.size() && countNonZero(untiled != tiled) == 0;
+
+        for(size_t c = 0; same && c < components.size(); c++)
+            same = components[c].mbr_min == tiledComps[c].mbr_min && components[c].mbr_max == tiledComps[c].mbr_max
+                   && components[c].seed == tiledComps[c].seed && components[c].numBlackPixels == tiledComps[c].numBlackPixels;
+
+        if(!same)
+        {
+            cout << "image " << n << " (" << rows << " x " << cols << "), tile size " << tileSize << ": tiled text removal differs\n";
+            failures++;
+        }
+    }
+
+    // the images have to contain text for the test to mean anything
+    if(removed == 0)
+    {
+        cout << "no text was removed from any image\n";
+        failures++;
+    }
+
+    return failures;
+}
@@ -0,0 +1,130 @@
+/**
+  * Stress test of ConcurrentUnionFind: several threads merge random and
+  * adversarial pairs (long chains, stars, repeated pairs) into one
+  * structure at the same time while they look up other objects. The
+  * result is compared with the sequential UnionFind after the same
+  * merges: same sets, same number of sets, and every object finds the
+  * smallest id of its set.
+  *
+  * Author: phugen
+  */
+
+#include "test/tests.hpp"
+#include "include/text_segmentation/unionfind.hpp"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+
+// Merges of one of several shapes on n objects.
+static vector<pair<int, int> > makeMerges (int n, int shape, mt19937* random)
+{
+    vector<pair<int, int> > merges;
+    int m = (*random)() % (2 * n + 1);
+
+    for(int k = 0; k < m; k++)
+    {
+        int x = (*random)() % n;
+        int y;
+
+        switch(shape)
+        {
+            case 0: y = min(n - 1, x + 1); break; // chains of neighbors
+            case 1: x = n - 1 - k % n; y = max(0, x - 1); break; // one chain, from the end
+            case 2: y = (*random)() % 4; break; // stars around a few objects
+            case 3: y = x; break; // merges with itself
+            default: y = (*random)() % n; break;
+        }
+
+        merges.push_back(make_pair(x, y));
+
+        // repeat some merges, possibly on another thread
+        if((*random)() % 8 == 0)
+            merges.push_back(make_pair(y, x));
+    }
+
+    return merges;
+}
+
+// Returns the number of cases in which the concurrent
+// union find ends with other sets than the sequential one.
+int unionFindTest (int cases)
+{
+    mt19937 random(19);
+    int failures = 0;
+
+    for(int n = 0; n < cases; n++)
+    {
+        int objects = 1 + random() % 3000;
+        int threads = 2 + random() % 7;
+        int shape = random() % 6;
+
+        vector<pair<int, int> > merges = makeMerges(objects, shape, &random);
+
+        UnionFind sequential(objects);
+
+        for(auto m = merges.begin(); m != merges.end(); m++)
+            sequential.merge((*m).first, (*m).second);
+
+        ConcurrentUnionFind concurrent(objects);
+        atomic<bool> start(false);
+        atomic<int> broken(0); // merged pairs a thread didn't find connected
+        vector<thread> workers;
+
+        for(int t = 0; t < threads; t++)
+            workers.push_back(thread([&, t]()
+            {
+                mt19937 local(t);
+
+                // all threads start merging at the same time
+                while(!start)
+                    this_thread::yield();
+
+                for(size_t m = t; m < merges.size(); m += threads)
+                {
+                    concurrent.merge(merges[m].first, merges[m].second);
+
+                    if(!concurrent.connected(merges[m].first, merges[m].second))
+                        broken++;
+
+                    // lookups halve the paths other threads are walking
+                    concurrent.find(local() % objects);
+                }
+            }));
+
+        start = true;
+
+        for(auto w = workers.begin(); w != workers.end(); w++)
+            (*w).join();
+
+        // smallest object of each sequential set
+        vector<int> smallest(objects, objects);
+
+        for(int p = 0; p < objects; p++)
+        {
+            int root = sequential.find(p);
+            smallest[root] = min(smallest[root], p);
+        }
+
+        bool same = broken == 0 && concurrent.count() == sequential.count() && concurrent.size() == objects;
+
+        for(int p = 0; same && p < objects; p++)
+            same = concurrent.find(p) == smallest[sequential.find(p)];
+
+        if(!same)
+        {
+            cout << "case " << n << " (" << objects << " objects, " << merges.size() << " merges, " << threads
+                 << " threads, shape " << shape << "): concurrent sets differ\n";
+            failures++;
+        }
+    }
+
+    return failures;
+}